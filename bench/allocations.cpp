@@ -0,0 +1,92 @@
+#include "report.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Counts calls to the global allocator, so benchmarks can check how many
+// allocations their hot path makes
+static std::atomic<std::uint64_t> s_allocations = 0;
+
+void *operator new(std::size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *const pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        std::abort();
+    }
+    return pointer;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+// memory_resource and over-aligned types allocate through these
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    const auto align = static_cast<std::size_t>(alignment);
+    const auto aligned_size = (std::max<std::size_t>(size, 1) + align - 1) /
+                              align * align;
+#ifdef _WIN32
+    void *const pointer = _aligned_malloc(aligned_size, align);
+#else
+    void *const pointer = std::aligned_alloc(align, aligned_size);
+#endif
+    if (pointer == nullptr) {
+        std::abort();
+    }
+    return pointer;
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+static void free_aligned(void *pointer) noexcept {
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+    free_aligned(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+    free_aligned(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+    free_aligned(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+    free_aligned(pointer);
+}
+
+namespace linkollector::bench {
+
+std::uint64_t allocation_count() noexcept {
+    return s_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace linkollector::bench
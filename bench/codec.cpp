@@ -0,0 +1,130 @@
+#include "report.h"
+
+#include "activity.h"
+#include "protocol.h"
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace linkollector::bench {
+
+// The copying deserialize() the responder used before parsing into views,
+// kept as the baseline to compare against.
+static std::optional<std::pair<activity, std::string>>
+legacy_deserialize(gsl::span<const std::byte> msg) noexcept {
+    const auto &delimiter = protocol::activity_delimiter_bin;
+    const auto delimiter_begin = std::search(std::begin(msg),
+                                             std::end(msg),
+                                             std::begin(delimiter),
+                                             std::end(delimiter));
+
+    if (delimiter_begin == std::begin(msg) ||
+        delimiter_begin == std::end(msg)) {
+        return std::nullopt;
+    }
+
+    const auto activity_size = static_cast<std::size_t>(
+        std::distance(std::begin(msg), delimiter_begin));
+    const auto payload_offset = activity_size + delimiter.size();
+
+    if (payload_offset == msg.size()) {
+        return std::nullopt;
+    }
+
+    const auto *const data =
+        static_cast<const char *>(static_cast<const void *>(msg.data()));
+
+    std::string activity_string(data, activity_size);
+    std::string lowercase_activity;
+    std::transform(
+        std::begin(activity_string),
+        std::end(activity_string),
+        std::back_inserter(lowercase_activity),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    activity activity_ = activity::url;
+    if (lowercase_activity == "url") {
+        activity_ = activity::url;
+    } else if (lowercase_activity == "text") {
+        activity_ = activity::text;
+    } else {
+        return std::nullopt;
+    }
+
+    const auto *const payload =
+        std::next(data, static_cast<std::ptrdiff_t>(payload_offset));
+
+    return {std::make_pair(
+        activity_, std::string(payload, msg.size() - payload_offset))};
+}
+
+void run_codec_benchmarks(report &report_) {
+    constexpr std::array<std::size_t, 4> payload_sizes = {
+        64, 4 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+
+    volatile std::size_t sink = 0;
+
+    for (const auto payload_size : payload_sizes) {
+        const auto serialized = protocol::serialize(
+            activity::text, std::string(payload_size, 'x'));
+        const gsl::span<const std::byte> msg(
+            static_cast<const std::byte *>(
+                static_cast<const void *>(serialized.data())),
+            serialized.size());
+
+        const auto add_result = [&report_, &msg](std::string name,
+                                                 measurement result) {
+            const auto bytes = static_cast<double>(result.iterations) *
+                               static_cast<double>(msg.size());
+            report_.add(std::move(name),
+                        {{"message_bytes", static_cast<double>(msg.size())},
+                         {"bytes_per_second", bytes / result.seconds}});
+        };
+
+        add_result("deserialize/legacy", measure([&]() {
+                       const auto result = legacy_deserialize(msg);
+                       sink = sink + result->second.size();
+                   }));
+
+        add_result("deserialize", measure([&]() {
+                       const auto result = protocol::deserialize(msg);
+                       sink = sink + result->second.size();
+                   }));
+
+        const auto header =
+            protocol::v2::serialize_header(activity::text, payload_size);
+        const auto payload = msg.last(payload_size);
+
+        add_result("deserialize/v2", measure([&]() {
+                       const auto result =
+                           protocol::v2::deserialize(header, payload);
+                       sink = sink + result->second.size();
+                   }));
+    }
+
+    constexpr std::array<std::string_view, 4> activity_names = {
+        "url", "TEXT", "Text", "bogus"};
+
+    for (const auto name : activity_names) {
+        const auto result = measure([&]() {
+            const auto maybe_activity = activity_from_string(name);
+            sink = sink + (maybe_activity.has_value() ? 1 : 0);
+        });
+
+        report_.add("activity_from_string/" + std::string(name),
+                    {{"calls_per_second",
+                      static_cast<double>(result.iterations) /
+                          result.seconds}});
+    }
+}
+
+} // namespace linkollector::bench
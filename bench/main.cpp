@@ -0,0 +1,47 @@
+#include "report.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+int main(int argc, char *argv[]) {
+    std::string output_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view option(*std::next(argv, i));
+
+        if (option == "--output" && i + 1 < argc) {
+            output_path = *std::next(argv, ++i);
+            continue;
+        }
+
+        std::cerr << "Unknown option " << option << "\n";
+        return EXIT_FAILURE;
+    }
+
+    linkollector::bench::report report;
+
+    linkollector::bench::run_codec_benchmarks(report);
+    linkollector::bench::run_receive_benchmarks(report);
+    linkollector::bench::run_ring_benchmarks(report);
+    linkollector::bench::run_sink_benchmarks(report);
+    linkollector::bench::run_transport_benchmarks(report);
+    linkollector::bench::run_url_benchmarks(report);
+
+    if (output_path.empty()) {
+        report.write_json(std::cout);
+        return report.passed() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::ofstream output(output_path);
+    if (!output) {
+        std::cerr << "Could not open " << output_path << "\n";
+        return EXIT_FAILURE;
+    }
+
+    report.write_json(output);
+    return report.passed() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
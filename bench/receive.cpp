@@ -0,0 +1,134 @@
+#include "report.h"
+
+#include "activity.h"
+#include "buffer_pool.h"
+#include "protocol.h"
+#include "ring_buffer.h"
+#include "sink.h"
+#include "wrappers/zmq/context.h"
+#include "wrappers/zmq/message.h"
+#include "wrappers/zmq/socket.h"
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <thread>
+
+namespace linkollector::bench {
+
+// Receives, parses and writes out v2 requests the way a responder worker
+// does, and checks that once warmed up this makes no allocations.
+void run_receive_benchmarks(report &report_) {
+    constexpr std::size_t capacity = 4096;
+    constexpr std::uint64_t warm_up_count = 2 * capacity;
+    constexpr std::uint64_t count = 100000;
+    const std::string url = "https://example.com/articles/2024/some-title";
+    const std::string name = "receive/v2/pooled";
+
+    wrappers::zmq::context ctx;
+    wrappers::zmq::socket receiver(ctx, wrappers::zmq::socket::type::pull);
+    wrappers::zmq::socket sender(ctx, wrappers::zmq::socket::type::push);
+
+    if (!receiver.bind("inproc://bench-receive") ||
+        !sender.connect("inproc://bench-receive")) {
+        report_.fail(name);
+        return;
+    }
+
+    buffer_pool records(2048, 2 * ring_capacity(capacity));
+    buffer_pool receive_buffers(4096, 1);
+
+    std::array<std::byte, 4096> arena_buffer = {};
+    std::pmr::monotonic_buffer_resource arena(arena_buffer.data(),
+                                              arena_buffer.size());
+
+    sink output(sink::format::text, capacity);
+    if (!output.open(sink::target::file, null_device)) {
+        report_.fail(name);
+        return;
+    }
+
+    std::thread sender_thread([&sender, &url]() noexcept {
+        const auto header =
+            protocol::v2::serialize_header(activity::url, url.size());
+        std::string payload = url;
+
+        for (std::uint64_t i = 0; i < warm_up_count + count; ++i) {
+            wrappers::zmq::message header_msg(header.size());
+            std::copy(std::begin(header),
+                      std::end(header),
+                      header_msg.data().begin());
+            if (!sender.blocking_send_more(std::move(header_msg)) ||
+                !sender.blocking_send(gsl::span<std::byte>(
+                    static_cast<std::byte *>(
+                        static_cast<void *>(payload.data())),
+                    payload.size()))) {
+                return;
+            }
+        }
+    });
+
+    wrappers::zmq::message header_msg;
+    std::uint64_t received = 0;
+
+    const auto receive_one = [&]() {
+        if (!receiver.blocking_receive(header_msg) || !header_msg.more()) {
+            return false;
+        }
+
+        auto buffer = receive_buffers.acquire(4096);
+        const auto maybe_size = receiver.blocking_receive(buffer.data());
+        if (!maybe_size.has_value() || *maybe_size > buffer.data().size()) {
+            return false;
+        }
+
+        const auto maybe_item = protocol::v2::deserialize(
+            header_msg.data(), buffer.data().first(*maybe_size));
+        if (!maybe_item.has_value()) {
+            return false;
+        }
+
+        output.write(maybe_item->first, maybe_item->second, &records, &arena);
+        arena.release();
+        ++received;
+        return true;
+    };
+
+    while (received < warm_up_count && receive_one()) {
+    }
+
+    const auto allocations_before = allocation_count();
+    const auto start = std::chrono::steady_clock::now();
+
+    while (received < warm_up_count + count && receive_one()) {
+    }
+
+    const auto seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      start)
+            .count();
+    const auto allocations = allocation_count() - allocations_before;
+
+    sender_thread.join();
+
+    if (received != warm_up_count + count) {
+        report_.fail(name);
+        return;
+    }
+
+    report_.add(name,
+                {{"messages_per_second", static_cast<double>(count) / seconds},
+                 {"allocations_per_message",
+                  static_cast<double>(allocations) /
+                      static_cast<double>(count)}});
+    report_.check(name + " allocates nothing", allocations == 0);
+}
+
+} // namespace linkollector::bench
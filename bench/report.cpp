@@ -0,0 +1,67 @@
+#include "report.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace linkollector::bench {
+
+static void write_json_string(std::ostream &out, const std::string &str) {
+    out << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+void report::add(std::string name, std::vector<metric> metrics) {
+    this->m_results.push_back({std::move(name), std::move(metrics)});
+}
+
+void report::check(const std::string &name, bool passed) {
+    if (!passed) {
+        std::cerr << "Check " << name << " failed\n";
+        this->m_passed = false;
+    }
+}
+
+void report::fail(const std::string &name) {
+    std::cerr << "Benchmark " << name << " failed\n";
+    this->m_passed = false;
+}
+
+bool report::passed() const noexcept { return this->m_passed; }
+
+void report::write_json(std::ostream &out) const {
+    const auto precision = out.precision(12);
+
+    out << "{\n  \"results\": [";
+
+    bool first_result = true;
+    for (const auto &result_ : this->m_results) {
+        out << (first_result ? "\n" : ",\n") << "    {\"name\": ";
+        write_json_string(out, result_.name);
+
+        for (const auto &metric_ : result_.metrics) {
+            out << ", ";
+            write_json_string(out, metric_.name);
+            out << ": ";
+            // JSON has no representation for NaN or infinity
+            if (std::isfinite(metric_.value)) {
+                out << metric_.value;
+            } else {
+                out << "null";
+            }
+        }
+
+        out << "}";
+        first_result = false;
+    }
+
+    out << "\n  ]\n}\n";
+    out.precision(precision);
+}
+
+} // namespace linkollector::bench
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace linkollector::bench {
+
+struct metric final {
+    std::string name;
+    double value;
+};
+
+// Benchmark results, written out as JSON so runs can be compared across
+// releases.
+class report final {
+
+public:
+    void add(std::string name, std::vector<metric> metrics);
+    void write_json(std::ostream &out) const;
+
+    // Records the outcome of a check the run has to pass. A failed check
+    // is reported right away and makes the run fail.
+    void check(const std::string &name, bool passed);
+    // Records that a benchmark could not be run, which fails the run too.
+    void fail(const std::string &name);
+    [[nodiscard]] bool passed() const noexcept;
+
+private:
+    struct result final {
+        std::string name;
+        std::vector<metric> metrics;
+    };
+
+    std::vector<result> m_results;
+    bool m_passed = true;
+};
+
+#ifdef _WIN32
+constexpr const char *null_device = "NUL";
+#else
+constexpr const char *null_device = "/dev/null";
+#endif
+
+// Calls to the global operator new so far, from any thread.
+[[nodiscard]] std::uint64_t allocation_count() noexcept;
+
+struct measurement final {
+    std::uint64_t iterations;
+    double seconds;
+};
+
+// Calls function repeatedly for at least min_duration.
+template <typename Function>
+[[nodiscard]] measurement
+measure(Function &&function,
+        std::chrono::milliseconds min_duration = std::chrono::milliseconds(
+            250)) noexcept {
+    using clock = std::chrono::steady_clock;
+
+    std::uint64_t iterations = 0;
+    const auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+
+    while (elapsed < min_duration) {
+        function();
+        ++iterations;
+        elapsed = clock::now() - start;
+    }
+
+    return {iterations, std::chrono::duration<double>(elapsed).count()};
+}
+
+void run_codec_benchmarks(report &report_);
+void run_receive_benchmarks(report &report_);
+void run_ring_benchmarks(report &report_);
+void run_sink_benchmarks(report &report_);
+void run_transport_benchmarks(report &report_);
+void run_url_benchmarks(report &report_);
+
+} // namespace linkollector::bench
@@ -0,0 +1,173 @@
+#include "report.h"
+
+#include "ring_buffer.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace linkollector::bench {
+
+using clock = std::chrono::steady_clock;
+
+constexpr std::size_t ring_size = 4096;
+
+// The mutex-guarded queue the sink used before the ring, kept as the
+// baseline to compare against.
+class locked_queue final {
+
+public:
+    [[nodiscard]] bool try_push(std::uint64_t &value) noexcept {
+        {
+            const std::lock_guard<std::mutex> lock(this->m_mutex);
+            if (this->m_items.size() == ring_size) {
+                return false;
+            }
+            this->m_items.push_back(value);
+        }
+        this->m_not_empty.notify_one();
+        return true;
+    }
+
+    [[nodiscard]] bool pop(std::uint64_t &value) noexcept {
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        this->m_not_empty.wait(lock,
+                               [this]() { return !this->m_items.empty(); });
+        value = this->m_items.front();
+        this->m_items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::deque<std::uint64_t> m_items;
+};
+
+// Pops with the wait point the sink's writer uses
+template <typename Ring> struct waiting_consumer final {
+    Ring &ring;
+    wait_point &not_empty;
+
+    [[nodiscard]] bool pop(std::uint64_t &value) noexcept {
+        this->not_empty.wait([this, &value]() {
+            return this->ring.try_pop(value);
+        });
+        return true;
+    }
+};
+
+// Moves count items from producer_count threads to one consumer and
+// returns the items handed over per second.
+template <typename Queue, typename Consumer>
+[[nodiscard]] static double measure_handoff(Queue &queue,
+                                            Consumer &consumer,
+                                            wait_point *not_empty,
+                                            unsigned int producer_count,
+                                            std::uint64_t count) noexcept {
+    const auto per_producer = count / producer_count;
+
+    const auto start = clock::now();
+
+    std::vector<std::thread> producers;
+    for (unsigned int i = 0; i < producer_count; ++i) {
+        producers.emplace_back([&queue, not_empty, per_producer]() noexcept {
+            for (std::uint64_t item = 0; item < per_producer; ++item) {
+                auto value = item;
+                // Yield rather than spin, the consumer may share the core
+                while (!queue.try_push(value)) {
+                    std::this_thread::yield();
+                }
+                if (not_empty != nullptr) {
+                    not_empty->notify();
+                }
+            }
+        });
+    }
+
+    std::uint64_t checksum = 0;
+    for (std::uint64_t i = 0; i < per_producer * producer_count; ++i) {
+        std::uint64_t value = 0;
+        if (consumer.pop(value)) {
+            checksum += value;
+        }
+    }
+
+    const auto seconds =
+        std::chrono::duration<double>(clock::now() - start).count();
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    const auto expected =
+        producer_count * (per_producer * (per_producer - 1) / 2);
+    return checksum == expected
+               ? static_cast<double>(per_producer * producer_count) / seconds
+               : -1.0;
+}
+
+static void add_result(report &report_,
+                       const std::string &name,
+                       unsigned int producer_count,
+                       double items_per_second) {
+    report_.add(name + "/" + std::to_string(producer_count),
+                {{"producers", static_cast<double>(producer_count)},
+                 {"items_per_second", items_per_second}});
+}
+
+void run_ring_benchmarks(report &report_) {
+    constexpr std::uint64_t item_count = 4000000;
+    constexpr std::array<wait_strategy, 2> strategies = {wait_strategy::block,
+                                                         wait_strategy::spin};
+
+    for (const auto strategy : strategies) {
+        const std::string suffix =
+            strategy == wait_strategy::block ? "/block" : "/spin";
+
+        {
+            spsc_ring<std::uint64_t> ring(ring_size);
+            wait_point not_empty(strategy);
+            waiting_consumer<spsc_ring<std::uint64_t>> consumer{ring,
+                                                                not_empty};
+            add_result(report_,
+                       "ring/spsc" + suffix,
+                       1,
+                       measure_handoff(
+                           ring, consumer, &not_empty, 1, item_count));
+        }
+
+        for (const unsigned int producer_count : {1U, 4U}) {
+            mpsc_ring<std::uint64_t> ring(ring_size);
+            wait_point not_empty(strategy);
+            waiting_consumer<mpsc_ring<std::uint64_t>> consumer{ring,
+                                                                not_empty};
+            add_result(report_,
+                       "ring/mpsc" + suffix,
+                       producer_count,
+                       measure_handoff(ring,
+                                       consumer,
+                                       &not_empty,
+                                       producer_count,
+                                       item_count));
+        }
+    }
+
+    for (const unsigned int producer_count : {1U, 4U}) {
+        locked_queue queue;
+        add_result(report_,
+                   "ring/locked_queue",
+                   producer_count,
+                   measure_handoff(
+                       queue, queue, nullptr, producer_count, item_count));
+    }
+}
+
+} // namespace linkollector::bench
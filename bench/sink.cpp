@@ -0,0 +1,66 @@
+#include "report.h"
+
+#include "activity.h"
+#include "buffer_pool.h"
+#include "ring_buffer.h"
+#include "sink.h"
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+namespace linkollector::bench {
+
+void run_sink_benchmarks(report &report_) {
+    constexpr std::size_t capacity = 4096;
+    constexpr std::size_t warm_up_records = 2 * capacity;
+    const std::string url = "https://example.com/articles/2024/some-title";
+
+    for (const bool pooled : {false, true}) {
+        const std::string name =
+            pooled ? "sink/write/pooled" : "sink/write/heap";
+
+        // Outlives the sink, which gives the records back on destruction.
+        // Covers the ring and the batch being written, like the pools of
+        // a single responder worker.
+        buffer_pool pool(2048, 2 * ring_capacity(capacity));
+        buffer_pool *const pool_ = pooled ? &pool : nullptr;
+
+        std::array<std::byte, 4096> arena_buffer = {};
+        std::pmr::monotonic_buffer_resource arena(arena_buffer.data(),
+                                                  arena_buffer.size());
+        std::pmr::memory_resource *const arena_ = pooled ? &arena : nullptr;
+
+        sink output(sink::format::text, capacity);
+        if (!output.open(sink::target::file, null_device)) {
+            report_.fail(name);
+            continue;
+        }
+
+        const auto write = [&]() {
+            output.write(activity::url, url, pool_, arena_);
+            arena.release();
+        };
+
+        for (std::size_t i = 0; i < warm_up_records; ++i) {
+            write();
+        }
+
+        const auto allocations_before = allocation_count();
+        const auto result = measure(write);
+        const auto allocations = allocation_count() - allocations_before;
+
+        const auto records = static_cast<double>(result.iterations);
+        report_.add(name,
+                    {{"records_per_second", records / result.seconds},
+                     {"allocations_per_record",
+                      static_cast<double>(allocations) / records}});
+
+        if (pooled) {
+            report_.check(name + " allocates nothing", allocations == 0);
+        }
+    }
+}
+
+} // namespace linkollector::bench
@@ -0,0 +1,216 @@
+#include "report.h"
+
+#include "wrappers/zmq/context.h"
+#include "wrappers/zmq/message.h"
+#include "wrappers/zmq/poller.h"
+#include "wrappers/zmq/socket.h"
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace linkollector::bench {
+
+struct transport final {
+    const char *name;
+    // Wildcards let libzmq pick a free port and a socket file in a
+    // temporary directory, so runs neither collide nor leave files behind
+    const char *bind_endpoint;
+};
+
+constexpr std::array transports = {
+    transport{"inproc", "inproc://bench"},
+#ifndef _WIN32
+    transport{"ipc", "ipc://*"},
+#endif
+    transport{"tcp", "tcp://127.0.0.1:*"},
+};
+
+// Binds server to the transport and connects client to wherever it ended
+// up.
+[[nodiscard]] static bool
+connect_pair(const transport &transport_,
+             wrappers::zmq::socket &server,
+             wrappers::zmq::socket &client) noexcept {
+    if (!server.bind(transport_.bind_endpoint)) {
+        return false;
+    }
+
+    const auto maybe_endpoint = server.last_endpoint();
+    return maybe_endpoint.has_value() && client.connect(*maybe_endpoint);
+}
+
+using clock = std::chrono::steady_clock;
+
+// Pushes count messages of message_size bytes through a PUSH/PULL pair and
+// returns the time the receiver took to drain them, or a negative value on
+// failure.
+[[nodiscard]] static double
+measure_throughput(const transport &transport_,
+                   std::size_t message_size,
+                   std::uint64_t count) noexcept {
+    wrappers::zmq::context ctx;
+    wrappers::zmq::socket receiver(ctx, wrappers::zmq::socket::type::pull);
+    wrappers::zmq::socket sender(ctx, wrappers::zmq::socket::type::push);
+
+    if (!connect_pair(transport_, receiver, sender)) {
+        return -1.0;
+    }
+
+    wrappers::zmq::poller poller;
+    if (!poller.add(receiver, wrappers::zmq::poll_event::in)) {
+        return -1.0;
+    }
+
+    std::thread sender_thread([&sender, message_size, count]() noexcept {
+        std::vector<std::byte> payload(message_size, std::byte{'x'});
+        for (std::uint64_t i = 0; i < count; ++i) {
+            if (!sender.blocking_send(payload)) {
+                return;
+            }
+        }
+    });
+
+    std::uint64_t received = 0;
+    const auto on_message = [](void *received_, gsl::span<std::byte>) {
+        ++*static_cast<std::uint64_t *>(received_);
+    };
+
+    const auto start = clock::now();
+
+    while (received < count) {
+        const auto maybe_responses =
+            poller.wait(std::chrono::milliseconds(1000));
+        if (!maybe_responses.has_value() || maybe_responses->empty()) {
+            break;
+        }
+
+        if (!receiver.async_receive(static_cast<void *>(&received),
+                                    on_message)) {
+            break;
+        }
+    }
+
+    const auto seconds =
+        std::chrono::duration<double>(clock::now() - start).count();
+
+    sender_thread.join();
+    return received == count ? seconds : -1.0;
+}
+
+// Measures count REQ/REP round trips of message_size bytes and returns the
+// sorted round-trip times, or nothing on failure.
+[[nodiscard]] static std::vector<double>
+measure_round_trips(const transport &transport_,
+                    std::size_t message_size,
+                    std::uint64_t count) noexcept {
+    wrappers::zmq::context ctx;
+    wrappers::zmq::socket responder(ctx, wrappers::zmq::socket::type::rep);
+    wrappers::zmq::socket requester(ctx, wrappers::zmq::socket::type::req);
+
+    if (!connect_pair(transport_, responder, requester)) {
+        return {};
+    }
+
+    std::thread responder_thread([&responder, count]() noexcept {
+        wrappers::zmq::message msg;
+        for (std::uint64_t i = 0; i < count; ++i) {
+            if (!responder.blocking_receive(msg) ||
+                !responder.blocking_send(std::move(msg))) {
+                return;
+            }
+        }
+    });
+
+    std::vector<double> round_trips;
+    round_trips.reserve(count);
+
+    std::vector<std::byte> payload(message_size, std::byte{'x'});
+    wrappers::zmq::message reply;
+
+    for (std::uint64_t i = 0; i < count; ++i) {
+        const auto start = clock::now();
+        if (!requester.blocking_send(payload) ||
+            !requester.blocking_receive(reply)) {
+            break;
+        }
+        round_trips.push_back(
+            std::chrono::duration<double, std::micro>(clock::now() - start)
+                .count());
+    }
+
+    responder_thread.join();
+
+    if (round_trips.size() != count) {
+        return {};
+    }
+
+    std::sort(std::begin(round_trips), std::end(round_trips));
+    return round_trips;
+}
+
+[[nodiscard]] static double percentile(const std::vector<double> &sorted,
+                                       double fraction) noexcept {
+    const auto index = static_cast<std::size_t>(
+        fraction * static_cast<double>(sorted.size() - 1));
+    return sorted.at(index);
+}
+
+void run_transport_benchmarks(report &report_) {
+    constexpr std::array<std::size_t, 3> message_sizes = {64, 4096, 65536};
+    constexpr std::uint64_t max_messages = 200000;
+    constexpr std::uint64_t bytes_per_run = 256U * 1024U * 1024U;
+    constexpr std::uint64_t round_trip_count = 20000;
+
+    for (const auto &transport_ : transports) {
+        for (const auto message_size : message_sizes) {
+            const auto count =
+                std::min(max_messages, bytes_per_run / message_size);
+            const auto seconds =
+                measure_throughput(transport_, message_size, count);
+
+            const auto name = std::string("send_receive/") + transport_.name;
+
+            if (seconds < 0.0) {
+                report_.fail(name);
+                continue;
+            }
+
+            const auto messages_per_second =
+                static_cast<double>(count) / seconds;
+            report_.add(
+                name,
+                {{"message_bytes", static_cast<double>(message_size)},
+                 {"messages_per_second", messages_per_second},
+                 {"bytes_per_second",
+                  messages_per_second * static_cast<double>(message_size)}});
+        }
+
+        const auto round_trips =
+            measure_round_trips(transport_, 64, round_trip_count);
+
+        const auto name = std::string("round_trip/") + transport_.name;
+
+        if (round_trips.empty()) {
+            report_.fail(name);
+            continue;
+        }
+
+        report_.add(name,
+                    {{"message_bytes", 64.0},
+                     {"p50_us", percentile(round_trips, 0.5)},
+                     {"p90_us", percentile(round_trips, 0.9)},
+                     {"p99_us", percentile(round_trips, 0.99)},
+                     {"p999_us", percentile(round_trips, 0.999)},
+                     {"max_us", round_trips.back()}});
+    }
+}
+
+} // namespace linkollector::bench
@@ -0,0 +1,54 @@
+#include "report.h"
+
+#include "url.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace linkollector::bench {
+
+void run_url_benchmarks(report &report_) {
+    constexpr std::array<std::pair<std::string_view, std::string_view>, 4>
+        samples = {{
+            {"canonical", "https://example.com/articles/2024/some-title"},
+            {"normalize",
+             "HTTPS://WWW.Example.COM:443/a/./b/../c/%7Euser/index.html"},
+            {"tracking",
+             "https://shop.example.org/item?id=42&utm_source=news&utm_"
+             "medium=email&utm_campaign=fall&fbclid=IwAR0abc#reviews"},
+            {"malformed", "https://exa mple.com/not a url"},
+        }};
+
+    // Each call works on a fresh copy, as the responder does on a received
+    // frame, so the copy is part of the measured cost
+    constexpr std::size_t batch_size = 1024;
+    std::string buffer;
+    volatile std::size_t sink = 0;
+
+    for (const auto &[name, sample] : samples) {
+        buffer.reserve(sample.size());
+
+        const auto result = measure([&]() {
+            for (std::size_t i = 0; i < batch_size; ++i) {
+                buffer.assign(sample);
+                const auto maybe_size =
+                    url::canonicalize({buffer.data(), buffer.size()});
+                sink = sink + maybe_size.value_or(0);
+            }
+        });
+
+        const auto urls =
+            static_cast<double>(result.iterations * batch_size);
+        report_.add("url/canonicalize/" + std::string(name),
+                    {{"url_bytes", static_cast<double>(sample.size())},
+                     {"urls_per_second", urls / result.seconds},
+                     {"bytes_per_second",
+                      urls * static_cast<double>(sample.size()) /
+                          result.seconds}});
+    }
+}
+
+} // namespace linkollector::bench
@@ -0,0 +1,46 @@
+#include "activity.h"
+
+#include "macros.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <string_view>
+
+namespace linkollector {
+
+std::string activity_to_string(activity activity_) noexcept {
+    switch (activity_) {
+    case activity::url: {
+        return "URL";
+    }
+    case activity::text: {
+        return "TEXT";
+    }
+    }
+    LINKOLLECTOR_UNREACHABLE;
+}
+
+[[nodiscard]] static bool
+equals_ignoring_case(std::string_view lhs, std::string_view rhs) noexcept {
+    return std::equal(std::begin(lhs),
+                      std::end(lhs),
+                      std::begin(rhs),
+                      std::end(rhs),
+                      [](unsigned char l, unsigned char r) {
+                          return std::tolower(l) == std::tolower(r);
+                      });
+}
+
+std::optional<activity>
+activity_from_string(const std::string_view activity_) noexcept {
+    if (equals_ignoring_case(activity_, "url")) {
+        return activity::url;
+    }
+    if (equals_ignoring_case(activity_, "text")) {
+        return activity::text;
+    }
+    return std::nullopt;
+}
+
+} // namespace linkollector
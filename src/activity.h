@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace linkollector {
+
+enum class activity { url, text };
+
+// Length of the longest activity name, "TEXT"
+constexpr std::size_t max_activity_length = 4;
+
+[[nodiscard]] std::string activity_to_string(activity activity_) noexcept;
+
+[[nodiscard]] std::optional<activity>
+activity_from_string(std::string_view activity_) noexcept;
+
+} // namespace linkollector
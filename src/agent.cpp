@@ -0,0 +1,299 @@
+#include "agent.h"
+
+#include "protocol.h"
+#include "sender.h"
+#include "signal_helper.h"
+#include "wrappers/zmq/context.h"
+#include "wrappers/zmq/message.h"
+#include "wrappers/zmq/poller.h"
+#include "wrappers/zmq/socket.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string_view>
+#include <utility>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace linkollector::agent {
+
+// An agent on the same machine answers well within this, anything slower
+// is taken to be a stale socket file
+constexpr std::chrono::milliseconds handoff_timeout{1000};
+
+// Identity, delimiter, server, header, payload
+constexpr std::size_t request_frames = 5;
+
+// Per-user so agents of different users do not collide. ZeroMQ has no IPC
+// transport on Windows.
+[[nodiscard]] static std::optional<std::string> socket_path() {
+#ifdef _WIN32
+    return std::nullopt;
+#else
+    const char *const runtime_directory = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_directory != nullptr && *runtime_directory != '\0') {
+        return std::string(runtime_directory) + "/linkollector-agent";
+    }
+    return "/tmp/linkollector-agent-" + std::to_string(::getuid());
+#endif
+}
+
+[[nodiscard]] static bool socket_exists(const std::string &path) noexcept {
+#ifdef _WIN32
+    return false;
+#else
+    struct stat status = {};
+    return ::stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode);
+#endif
+}
+
+// Receives one whole message into frames, returning its frame count.
+// Frames beyond the array are received and dropped.
+[[nodiscard]] static std::optional<std::size_t>
+receive_frames(wrappers::zmq::socket &sock,
+               std::array<wrappers::zmq::message, request_frames> &frames,
+               wrappers::zmq::message &overflow) noexcept {
+    std::size_t count = 0;
+
+    do {
+        auto &frame = count < frames.size() ? frames.at(count) : overflow;
+        if (!sock.blocking_receive(frame)) {
+            return std::nullopt;
+        }
+        ++count;
+    } while ((count <= frames.size() ? frames.at(count - 1) : overflow)
+                 .more());
+
+    return count;
+}
+
+[[nodiscard]] static wrappers::zmq::message
+status_frame(protocol::v2::status status) noexcept {
+    wrappers::zmq::message frame(sizeof(status));
+    frame.data()[0] = static_cast<std::byte>(status);
+    return frame;
+}
+
+int run(wrappers::zmq::context &ctx,
+        const signal_helper::sigint_guard &signals,
+        const std::vector<std::string> &servers) noexcept {
+    const auto maybe_path = socket_path();
+    if (!maybe_path.has_value()) {
+        std::cerr << "The agent is not supported on this platform\n";
+        return EXIT_FAILURE;
+    }
+
+    wrappers::zmq::socket local_socket(ctx,
+                                       wrappers::zmq::socket::type::router);
+    if (!local_socket.bind("ipc://" + *maybe_path)) {
+        std::cerr << "Failed to bind the agent socket " << *maybe_path
+                  << "\n";
+        return EXIT_FAILURE;
+    }
+
+    wrappers::zmq::poller poller;
+    if (!poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in) ||
+        !poller.add(local_socket, wrappers::zmq::poll_event::in)) {
+        std::cerr << "Failed to register the agent sockets\n";
+        return EXIT_FAILURE;
+    }
+
+    // Map nodes never move, so the poller may point at the sockets
+    std::map<std::string, wrappers::zmq::socket, std::less<>> upstreams;
+
+    const auto upstream_for =
+        [&ctx, &poller, &upstreams](
+            std::string_view server) -> wrappers::zmq::socket * {
+        const auto it = upstreams.find(server);
+        if (it != upstreams.end()) {
+            return &it->second;
+        }
+
+        wrappers::zmq::socket upstream(ctx,
+                                       wrappers::zmq::socket::type::dealer);
+        const std::string server_(server);
+        if (!upstream.connect(sender::endpoint_for(server_))) {
+            std::cerr << "Failed to connect to " << server_ << "\n";
+            return nullptr;
+        }
+
+        auto &added =
+            upstreams.emplace(server_, std::move(upstream)).first->second;
+        if (!poller.add(added, wrappers::zmq::poll_event::in)) {
+            upstreams.erase(server_);
+            return nullptr;
+        }
+        return &added;
+    };
+
+    for (const auto &server : servers) {
+        if (upstream_for(server) == nullptr) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << "Agent listening on " << *maybe_path
+              << ", press CTRL+C to cancel..." << std::endl;
+
+    std::uint64_t forwarded = 0;
+    std::uint64_t acknowledged = 0;
+    std::uint64_t rejected = 0;
+
+    std::array<wrappers::zmq::message, request_frames> frames;
+    wrappers::zmq::message overflow;
+
+    int rc = EXIT_SUCCESS;
+    bool break_loop = false;
+
+    while (!break_loop) {
+        const auto maybe_responses = poller.wait();
+
+        if (!maybe_responses.has_value()) {
+            std::cerr << "Failure in zmq_poller_wait_all, killing agent...\n";
+            rc = EXIT_FAILURE;
+            break;
+        }
+
+        for (const auto &response : *maybe_responses) {
+            if (response.response_event != wrappers::zmq::poll_event::in) {
+                continue;
+            }
+
+            if (signals.raised_in(response)) {
+                break_loop = true;
+                break;
+            }
+
+            const auto maybe_count =
+                receive_frames(*response.response_socket, frames, overflow);
+            if (!maybe_count.has_value()) {
+                std::cerr << "Failure in zmq_msg_recv, killing agent...\n";
+                rc = EXIT_FAILURE;
+                break_loop = true;
+                break;
+            }
+
+            // Replies from a server: delimiter and status
+            if (response.response_socket != &local_socket) {
+                const auto &status_frame_ = frames.at(1);
+                const bool ok =
+                    *maybe_count == 2 && status_frame_.size() == 1 &&
+                    static_cast<protocol::v2::status>(
+                        std::to_integer<std::uint8_t>(
+                            status_frame_.data()[0])) ==
+                        protocol::v2::status::ok;
+                ++acknowledged;
+                if (!ok) {
+                    ++rejected;
+                    std::cerr << "A server rejected an item\n";
+                }
+                continue;
+            }
+
+            auto &identity = frames.at(0);
+            auto &server_frame = frames.at(2);
+            auto &header = frames.at(3);
+            auto &payload = frames.at(4);
+
+            const auto server_data = server_frame.data();
+            const std::string_view server(
+                static_cast<const char *>(
+                    static_cast<const void *>(server_data.data())),
+                server_data.size());
+
+            const bool valid =
+                *maybe_count == request_frames && !server.empty() &&
+                protocol::v2::deserialize(header.data(), payload.data())
+                    .has_value() &&
+                !protocol::v2::is_chunk(header.data());
+
+            auto *const upstream = valid ? upstream_for(server) : nullptr;
+
+            const bool queued =
+                upstream != nullptr &&
+                upstream->blocking_send_more(wrappers::zmq::message()) &&
+                upstream->blocking_send_more(std::move(header)) &&
+                upstream->blocking_send(std::move(payload));
+
+            if (queued) {
+                ++forwarded;
+            }
+
+            if (!local_socket.blocking_send_more(std::move(identity)) ||
+                !local_socket.blocking_send_more(wrappers::zmq::message()) ||
+                !local_socket.blocking_send(
+                    status_frame(queued ? protocol::v2::status::ok
+                                        : protocol::v2::status::rejected))) {
+                std::cerr << "Failed to answer a local sender\n";
+            }
+        }
+    }
+
+    std::cout << "Forwarded " << forwarded << " items, " << acknowledged
+              << " acknowledged, " << rejected << " rejected";
+    if (forwarded > acknowledged) {
+        std::cout << ", " << forwarded - acknowledged
+                  << " not acknowledged yet and possibly lost";
+    }
+    std::cout << "\n";
+
+    // Later senders would otherwise wait for a reply from a dead agent
+    std::remove(maybe_path->c_str());
+    return rc;
+}
+
+std::optional<int> send(wrappers::zmq::context &ctx,
+                        const std::string &server,
+                        activity activity_,
+                        const std::string &message) noexcept {
+    const auto maybe_path = socket_path();
+    if (!maybe_path.has_value() || !socket_exists(*maybe_path)) {
+        return std::nullopt;
+    }
+
+    wrappers::zmq::socket agent_socket(ctx, wrappers::zmq::socket::type::req);
+    if (!agent_socket.connect("ipc://" + *maybe_path) ||
+        !agent_socket.blocking_send_more(
+            wrappers::zmq::message(std::string(server))) ||
+        !sender::send_v2(agent_socket, activity_, std::string(message))) {
+        return std::nullopt;
+    }
+
+    wrappers::zmq::poller poller;
+    if (!poller.add(agent_socket, wrappers::zmq::poll_event::in)) {
+        return std::nullopt;
+    }
+
+    const auto maybe_responses = poller.wait(handoff_timeout);
+    if (!maybe_responses.has_value() || maybe_responses->empty()) {
+        return std::nullopt;
+    }
+
+    wrappers::zmq::message reply;
+    if (!agent_socket.blocking_receive(reply)) {
+        return std::nullopt;
+    }
+
+    if (reply.size() != 1 || static_cast<protocol::v2::status>(
+                                 std::to_integer<std::uint8_t>(
+                                     reply.data()[0])) !=
+                                 protocol::v2::status::ok) {
+        std::cerr << "The agent rejected the item\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Handed " << activity_to_string(activity_) << " \""
+              << message << "\" to the agent for " << server << "\n";
+    return EXIT_SUCCESS;
+}
+
+} // namespace linkollector::agent
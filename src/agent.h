@@ -0,0 +1,40 @@
+#pragma once
+
+#include "activity.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace wrappers::zmq {
+class context;
+} // namespace wrappers::zmq
+
+namespace linkollector::signal_helper {
+class sigint_guard;
+} // namespace linkollector::signal_helper
+
+// A long-running sender that keeps its connections to the servers open.
+// Local senders hand items to it over an IPC socket, which costs far less
+// than setting up a TCP connection per item.
+//
+// A local request is a REQ message of three frames: the server name, then
+// a v2 header and payload. The agent answers with a one-byte v2 status as
+// soon as it has queued the item for the server; the server's own
+// verdict is only reported in the agent's log.
+namespace linkollector::agent {
+
+// Connects to servers up front; connections to other servers are opened on
+// first use.
+[[nodiscard]] int run(wrappers::zmq::context &ctx,
+                      const signal_helper::sigint_guard &signals,
+                      const std::vector<std::string> &servers) noexcept;
+
+// Hands an item to a running agent. Returns the exit code, or nothing if no
+// agent answered, in which case the item was not sent.
+[[nodiscard]] std::optional<int> send(wrappers::zmq::context &ctx,
+                                      const std::string &server,
+                                      activity activity_,
+                                      const std::string &message) noexcept;
+
+} // namespace linkollector::agent
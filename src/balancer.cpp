@@ -0,0 +1,176 @@
+#include "balancer.h"
+
+#include "sender.h"
+#include "wrappers/zmq/context.h"
+#include "wrappers/zmq/poller.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace linkollector {
+
+static constexpr std::chrono::milliseconds initial_probe_delay(1000);
+static constexpr std::chrono::milliseconds max_probe_delay(30000);
+
+balancer::balancer(wrappers::zmq::context &ctx,
+                   wrappers::zmq::poller &poller,
+                   std::vector<std::string> servers,
+                   policy policy_) noexcept
+    : m_ctx(ctx), m_poller(poller), m_policy(policy_) {
+    this->m_endpoints.reserve(servers.size());
+    for (auto &server_ : servers) {
+        endpoint endpoint_;
+        endpoint_.server = std::move(server_);
+        endpoint_.probe_delay = initial_probe_delay;
+        this->m_endpoints.push_back(std::move(endpoint_));
+    }
+}
+
+balancer::~balancer() noexcept {
+    for (auto &endpoint_ : this->m_endpoints) {
+        if (endpoint_.socket.has_value()) {
+            [[maybe_unused]] const bool removed =
+                this->m_poller.remove(*endpoint_.socket);
+        }
+    }
+}
+
+bool balancer::connect() noexcept {
+    return std::all_of(std::begin(this->m_endpoints),
+                       std::end(this->m_endpoints),
+                       [this](endpoint &endpoint_) {
+                           return this->open(endpoint_);
+                       });
+}
+
+std::size_t balancer::size() const noexcept {
+    return this->m_endpoints.size();
+}
+
+const std::string &balancer::server(std::size_t index) const noexcept {
+    return this->m_endpoints[index].server;
+}
+
+const balancer::server_stats &
+balancer::stats(std::size_t index) const noexcept {
+    return this->m_endpoints[index].stats;
+}
+
+wrappers::zmq::socket &balancer::socket(std::size_t index) noexcept {
+    return *this->m_endpoints[index].socket;
+}
+
+std::optional<std::size_t>
+balancer::index_of(const wrappers::zmq::socket *socket_) const noexcept {
+    for (std::size_t i = 0; i < this->m_endpoints.size(); ++i) {
+        const auto &endpoint_socket = this->m_endpoints[i].socket;
+        if (endpoint_socket.has_value() && &*endpoint_socket == socket_) {
+            return {i};
+        }
+    }
+    return std::nullopt;
+}
+
+std::size_t balancer::pick(clock::time_point now) noexcept {
+    const auto count = this->m_endpoints.size();
+    std::optional<std::size_t> best;
+
+    // Starting after the last pick spreads ties evenly
+    for (std::size_t offset = 0; offset < count; ++offset) {
+        const auto index = (this->m_next + offset) % count;
+        const auto &candidate = this->m_endpoints[index];
+
+        if (!this->usable(candidate, now)) {
+            continue;
+        }
+
+        if (this->m_policy == policy::round_robin) {
+            best = index;
+            break;
+        }
+
+        if (!best.has_value() ||
+            candidate.outstanding < this->m_endpoints[*best].outstanding) {
+            best = index;
+        }
+    }
+
+    if (!best.has_value()) {
+        best = static_cast<std::size_t>(std::distance(
+            std::begin(this->m_endpoints),
+            std::min_element(std::begin(this->m_endpoints),
+                             std::end(this->m_endpoints),
+                             [](const endpoint &a, const endpoint &b) {
+                                 return a.probe_at < b.probe_at;
+                             })));
+    }
+
+    this->m_next = (*best + 1) % count;
+    return *best;
+}
+
+void balancer::sent(std::size_t index) noexcept {
+    ++this->m_endpoints[index].outstanding;
+}
+
+void balancer::answered(std::size_t index) noexcept {
+    auto &endpoint_ = this->m_endpoints[index];
+
+    if (endpoint_.outstanding > 0) {
+        --endpoint_.outstanding;
+    }
+    ++endpoint_.stats.answered;
+
+    if (endpoint_.demoted) {
+        std::cerr << endpoint_.server << " is answering again\n";
+        endpoint_.demoted = false;
+        endpoint_.probe_delay = initial_probe_delay;
+    }
+}
+
+bool balancer::demote(std::size_t index, clock::time_point now) noexcept {
+    auto &endpoint_ = this->m_endpoints[index];
+
+    // A failed probe pushes the next one further out
+    if (endpoint_.demoted) {
+        endpoint_.probe_delay =
+            std::min(endpoint_.probe_delay * 2, max_probe_delay);
+    }
+
+    endpoint_.demoted = true;
+    endpoint_.probe_at = now + endpoint_.probe_delay;
+    endpoint_.outstanding = 0;
+    ++endpoint_.stats.demotions;
+
+    std::cerr << endpoint_.server << " is not answering, demoted for "
+              << endpoint_.probe_delay.count() << " ms\n";
+
+    return this->open(endpoint_);
+}
+
+bool balancer::usable(const endpoint &endpoint_,
+                      clock::time_point now) const noexcept {
+    return !endpoint_.demoted ||
+           (now >= endpoint_.probe_at && endpoint_.outstanding == 0);
+}
+
+// A fresh socket drops whatever the old one still had queued, and late
+// answers to it with it
+bool balancer::open(endpoint &endpoint_) noexcept {
+    if (endpoint_.socket.has_value()) {
+        [[maybe_unused]] const bool removed =
+            this->m_poller.remove(*endpoint_.socket);
+    }
+
+    endpoint_.socket.emplace(this->m_ctx, wrappers::zmq::socket::type::dealer);
+    if (!endpoint_.socket->connect(sender::endpoint_for(endpoint_.server)) ||
+        !this->m_poller.add(*endpoint_.socket,
+                            wrappers::zmq::poll_event::in)) {
+        std::cerr << "Failed to connect to " << endpoint_.server << "\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace linkollector
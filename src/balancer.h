@@ -0,0 +1,98 @@
+#pragma once
+
+#include "wrappers/zmq/socket.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace wrappers::zmq {
+class context;
+class poller;
+} // namespace wrappers::zmq
+
+namespace linkollector {
+
+// Spreads requests over several servers, each with its own DEALER socket
+// registered in a caller's poller. A server that lets a request time out
+// is demoted: it gets no requests until a probe time, then a single one
+// at a time until it answers again, and each failed probe doubles the
+// wait for the next one.
+class balancer final {
+
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum class policy {
+        // The server with the fewest requests awaiting an answer
+        least_outstanding,
+        round_robin,
+    };
+
+    struct server_stats final {
+        std::uint64_t answered = 0;
+        std::uint64_t demotions = 0;
+    };
+
+    explicit balancer(wrappers::zmq::context &ctx,
+                      wrappers::zmq::poller &poller,
+                      std::vector<std::string> servers,
+                      policy policy_) noexcept;
+    balancer(const balancer &other) = delete;
+    balancer &operator=(const balancer &other) = delete;
+    balancer(balancer &&other) noexcept = delete;
+    balancer &operator=(balancer &&other) noexcept = delete;
+    ~balancer() noexcept;
+
+    // Connects to every server.
+    [[nodiscard]] bool connect() noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] const std::string &server(std::size_t index) const noexcept;
+    [[nodiscard]] const server_stats &stats(std::size_t index) const noexcept;
+    [[nodiscard]] wrappers::zmq::socket &socket(std::size_t index) noexcept;
+
+    // Index of the server whose socket it is, if any
+    [[nodiscard]] std::optional<std::size_t>
+    index_of(const wrappers::zmq::socket *socket_) const noexcept;
+
+    // Server for the next request. When every server is demoted, the one
+    // due to be probed first is used anyway, so a lone server is retried
+    // right away.
+    [[nodiscard]] std::size_t pick(clock::time_point now) noexcept;
+
+    void sent(std::size_t index) noexcept;
+    void answered(std::size_t index) noexcept;
+
+    // Takes the server out of rotation and replaces its socket, dropping
+    // every request awaiting an answer from it.
+    [[nodiscard]] bool demote(std::size_t index,
+                              clock::time_point now) noexcept;
+
+private:
+    struct endpoint final {
+        std::string server;
+        std::optional<wrappers::zmq::socket> socket;
+        unsigned int outstanding = 0;
+        bool demoted = false;
+        clock::time_point probe_at;
+        std::chrono::milliseconds probe_delay;
+        server_stats stats;
+    };
+
+    [[nodiscard]] bool usable(const endpoint &endpoint_,
+                              clock::time_point now) const noexcept;
+    [[nodiscard]] bool open(endpoint &endpoint_) noexcept;
+
+    wrappers::zmq::context &m_ctx;
+    wrappers::zmq::poller &m_poller;
+    policy m_policy;
+    // Never resized, the poller holds pointers to the sockets
+    std::vector<endpoint> m_endpoints;
+    std::size_t m_next = 0;
+};
+
+} // namespace linkollector
@@ -0,0 +1,91 @@
+#include "buffer_pool.h"
+
+#include <iterator>
+#include <utility>
+
+namespace linkollector {
+
+buffer_pool::buffer::buffer(buffer_pool *owner,
+                            std::byte *data,
+                            std::size_t size) noexcept
+    : m_owner(owner), m_data(data), m_size(size) {}
+
+buffer_pool::buffer::buffer(buffer &&other) noexcept
+    : m_owner(std::exchange(other.m_owner, nullptr)),
+      m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)) {}
+
+buffer_pool::buffer &
+buffer_pool::buffer::operator=(buffer &&other) noexcept {
+    if (this != &other) {
+        this->release();
+        this->m_owner = std::exchange(other.m_owner, nullptr);
+        this->m_data = std::exchange(other.m_data, nullptr);
+        this->m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+buffer_pool::buffer::~buffer() noexcept { this->release(); }
+
+bool buffer_pool::buffer::empty() const noexcept {
+    return this->m_data == nullptr;
+}
+
+gsl::span<std::byte> buffer_pool::buffer::data() const noexcept {
+    return {this->m_data, this->m_size};
+}
+
+void buffer_pool::buffer::release() noexcept {
+    if (this->m_owner == nullptr) {
+        return;
+    }
+
+    // The ring holds every buffer the pool has, so this never fails
+    [[maybe_unused]] const bool released =
+        this->m_owner->m_returned.try_push(this->m_data);
+
+    this->m_owner = nullptr;
+    this->m_data = nullptr;
+    this->m_size = 0;
+}
+
+buffer_pool::buffer_pool(std::size_t buffer_size,
+                         std::size_t buffer_count) noexcept
+    : m_buffer_size(buffer_size), m_buffer_count(buffer_count),
+      // Left uninitialized so untouched buffers cost no memory
+      m_storage(new std::byte[buffer_size * buffer_count]),
+      m_returned(buffer_count) {
+    this->m_free.reserve(buffer_count);
+}
+
+buffer_pool::buffer buffer_pool::acquire(std::size_t size) noexcept {
+    if (size > this->m_buffer_size) {
+        return {};
+    }
+
+    if (this->m_free.empty()) {
+        std::byte *returned = nullptr;
+        while (this->m_returned.try_pop(returned)) {
+            this->m_free.push_back(returned);
+        }
+    }
+
+    if (!this->m_free.empty()) {
+        auto *const data = this->m_free.back();
+        this->m_free.pop_back();
+        return {this, data, this->m_buffer_size};
+    }
+
+    if (this->m_carved == this->m_buffer_count) {
+        return {};
+    }
+
+    auto *const data =
+        std::next(this->m_storage.get(),
+                  static_cast<std::ptrdiff_t>(this->m_carved++ *
+                                              this->m_buffer_size));
+    return {this, data, this->m_buffer_size};
+}
+
+} // namespace linkollector
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ring_buffer.h"
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace linkollector {
+
+// Fixed-size buffers handed out by one owning thread and given back from
+// any thread, so a record can be built on one thread and released on
+// another without touching the global allocator. All buffers are carved
+// from a single block reserved up front, whose pages are only touched once
+// a buffer is first used; released buffers come back through a ring and
+// are reused before any new one is carved.
+class buffer_pool final {
+
+public:
+    // A buffer on loan from a pool, given back when destroyed. An empty
+    // buffer has no storage.
+    class buffer final {
+
+    public:
+        buffer() noexcept = default;
+        buffer(const buffer &other) = delete;
+        buffer &operator=(const buffer &other) = delete;
+        buffer(buffer &&other) noexcept;
+        buffer &operator=(buffer &&other) noexcept;
+        ~buffer() noexcept;
+
+        [[nodiscard]] bool empty() const noexcept;
+        [[nodiscard]] gsl::span<std::byte> data() const noexcept;
+
+    private:
+        friend class buffer_pool;
+
+        buffer(buffer_pool *owner, std::byte *data, std::size_t size) noexcept;
+        void release() noexcept;
+
+        buffer_pool *m_owner = nullptr;
+        std::byte *m_data = nullptr;
+        std::size_t m_size = 0;
+    };
+
+    explicit buffer_pool(std::size_t buffer_size,
+                         std::size_t buffer_count) noexcept;
+    buffer_pool(const buffer_pool &other) = delete;
+    buffer_pool &operator=(const buffer_pool &other) = delete;
+    buffer_pool(buffer_pool &&other) noexcept = delete;
+    buffer_pool &operator=(buffer_pool &&other) noexcept = delete;
+
+    // Every buffer must have been given back.
+    ~buffer_pool() noexcept = default;
+
+    // Owning thread only. Returns an empty buffer if size does not fit a
+    // buffer or all of them are on loan.
+    [[nodiscard]] buffer acquire(std::size_t size) noexcept;
+
+private:
+    std::size_t m_buffer_size;
+    std::size_t m_buffer_count;
+    std::unique_ptr<std::byte[]> m_storage;
+
+    // Owned by the owning thread
+    std::size_t m_carved = 0;
+    std::vector<std::byte *> m_free;
+
+    mpsc_ring<std::byte *> m_returned;
+};
+
+} // namespace linkollector
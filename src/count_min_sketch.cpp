@@ -0,0 +1,56 @@
+#include "count_min_sketch.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace linkollector {
+
+static_assert((count_min_sketch::width & (count_min_sketch::width - 1)) == 0,
+              "width must be a power of two");
+
+count_min_sketch::count_min_sketch() : m_counters(depth * width, 0) {}
+
+std::uint32_t count_min_sketch::add(std::uint64_t hash) noexcept {
+    auto estimate = std::numeric_limits<std::uint32_t>::max();
+    for (std::size_t row = 0; row < depth; ++row) {
+        auto &counter = this->m_counters[index(hash, row)];
+        if (counter < std::numeric_limits<std::uint32_t>::max()) {
+            ++counter;
+        }
+        estimate = std::min(estimate, counter);
+    }
+    return estimate;
+}
+
+std::uint32_t count_min_sketch::estimate(std::uint64_t hash) const noexcept {
+    auto estimate = std::numeric_limits<std::uint32_t>::max();
+    for (std::size_t row = 0; row < depth; ++row) {
+        estimate = std::min(estimate, this->m_counters[index(hash, row)]);
+    }
+    return estimate;
+}
+
+void count_min_sketch::merge(const count_min_sketch &other) noexcept {
+    for (std::size_t i = 0; i < this->m_counters.size(); ++i) {
+        const auto sum =
+            std::uint64_t{this->m_counters[i]} + other.m_counters[i];
+        this->m_counters[i] = static_cast<std::uint32_t>(
+            std::min<std::uint64_t>(
+                sum, std::numeric_limits<std::uint32_t>::max()));
+    }
+}
+
+void count_min_sketch::clear() noexcept {
+    std::fill(this->m_counters.begin(), this->m_counters.end(), 0);
+}
+
+// Rows use independent-enough hashes derived from one 64-bit hash
+// (Kirsch-Mitzenmacher double hashing).
+std::size_t count_min_sketch::index(std::uint64_t hash,
+                                    std::size_t row) noexcept {
+    const auto low = hash & 0xffffffffU;
+    const auto high = hash >> 32U;
+    return row * width + ((low + row * high) & (width - 1));
+}
+
+} // namespace linkollector
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace linkollector {
+
+// Approximate frequency counts in fixed memory. An estimate never
+// undercounts and overcounts by at most e / width of the total count with
+// probability 1 - e^-depth.
+class count_min_sketch final {
+
+public:
+    static constexpr std::size_t depth = 4;
+    static constexpr std::size_t width = 8192;
+
+    explicit count_min_sketch();
+    count_min_sketch(const count_min_sketch &other) = default;
+    count_min_sketch &operator=(const count_min_sketch &other) = default;
+    count_min_sketch(count_min_sketch &&other) noexcept = default;
+    count_min_sketch &operator=(count_min_sketch &&other) noexcept = default;
+    ~count_min_sketch() noexcept = default;
+
+    // Counts the item with this hash once and returns its new estimate.
+    std::uint32_t add(std::uint64_t hash) noexcept;
+
+    [[nodiscard]] std::uint32_t estimate(std::uint64_t hash) const noexcept;
+
+    void merge(const count_min_sketch &other) noexcept;
+    void clear() noexcept;
+
+private:
+    [[nodiscard]] static std::size_t index(std::uint64_t hash,
+                                           std::size_t row) noexcept;
+
+    std::vector<std::uint32_t> m_counters;
+};
+
+} // namespace linkollector
@@ -0,0 +1,87 @@
+#include "dedup_cache.h"
+
+#include "hash.h"
+
+#include <algorithm>
+
+namespace linkollector {
+
+dedup_cache::dedup_cache(std::size_t memory_budget,
+                         std::chrono::milliseconds window) noexcept
+    : m_start(std::chrono::steady_clock::now()),
+      m_window_ms(static_cast<std::uint64_t>(window.count())),
+      m_shards(shard_count) {
+    // Largest power of two of buckets per shard that fits the budget
+    const auto budget_buckets =
+        std::max<std::size_t>(memory_budget / (shard_count * sizeof(bucket)),
+                              1);
+    std::size_t bucket_count = 1;
+    while (bucket_count * 2 <= budget_buckets) {
+        bucket_count *= 2;
+    }
+
+    this->m_bucket_mask = bucket_count - 1;
+
+    for (auto &shard_ : this->m_shards) {
+        // A zero hash marks an empty entry
+        shard_.buckets.resize(bucket_count, bucket{});
+    }
+}
+
+bool dedup_cache::check_and_insert(activity activity_,
+                                   std::string_view payload) noexcept {
+    // Zero is reserved for empty entries
+    const auto hash = std::max<std::uint64_t>(
+        hash64(payload, static_cast<std::uint64_t>(activity_)), 1);
+    const auto now = this->now_ms();
+
+    // The top bits pick the shard, the low bits the bucket
+    auto &shard_ = this->m_shards[hash >> 60U];
+    const std::lock_guard<std::mutex> lock(shard_.mutex);
+    auto &bucket_ = shard_.buckets[hash & this->m_bucket_mask];
+
+    entry *oldest = &bucket_.front();
+
+    for (auto &entry_ : bucket_) {
+        if (entry_.hash == hash) {
+            entry_.last_seen_ms = now;
+
+            if (now - entry_.first_seen_ms <= this->m_window_ms) {
+                this->m_hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // Seen before, but outside the window: starts a new window
+            entry_.first_seen_ms = now;
+            this->m_misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const bool is_older = oldest->hash != 0 &&
+                              entry_.last_seen_ms < oldest->last_seen_ms;
+        if (entry_.hash == 0 || is_older) {
+            oldest = &entry_;
+        }
+    }
+
+    *oldest = entry{hash, now, now};
+    this->m_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+std::uint64_t dedup_cache::hits() const noexcept {
+    return this->m_hits.load(std::memory_order_relaxed);
+}
+
+std::uint64_t dedup_cache::misses() const noexcept {
+    return this->m_misses.load(std::memory_order_relaxed);
+}
+
+std::uint64_t dedup_cache::now_ms() const noexcept {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - this->m_start)
+            .count());
+}
+
+} // namespace linkollector
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "activity.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace linkollector {
+
+// Remembers recently seen items in a fixed amount of memory to suppress
+// duplicates sent within a time window.
+//
+// Items are identified by a 64-bit hash. The table is set-associative: a
+// hash selects one bucket of ways entries, and a miss in a full bucket
+// evicts its least recently seen entry, so lookups stay O(1) no matter how
+// many entries the memory budget allows. The table is split into
+// independently locked shards so workers rarely contend.
+class dedup_cache final {
+
+public:
+    explicit dedup_cache(std::size_t memory_budget,
+                         std::chrono::milliseconds window) noexcept;
+    dedup_cache(const dedup_cache &other) = delete;
+    dedup_cache &operator=(const dedup_cache &other) = delete;
+    dedup_cache(dedup_cache &&other) noexcept = delete;
+    dedup_cache &operator=(dedup_cache &&other) noexcept = delete;
+    ~dedup_cache() noexcept = default;
+
+    // Returns true if the item was already seen within the window, and
+    // records it as seen now otherwise.
+    [[nodiscard]] bool check_and_insert(activity activity_,
+                                        std::string_view payload) noexcept;
+
+    [[nodiscard]] std::uint64_t hits() const noexcept;
+    [[nodiscard]] std::uint64_t misses() const noexcept;
+
+private:
+    static constexpr std::size_t ways = 8;
+    static constexpr std::size_t shard_count = 16;
+
+    struct entry final {
+        std::uint64_t hash;
+        std::uint64_t last_seen_ms;
+        std::uint64_t first_seen_ms;
+    };
+
+    using bucket = std::array<entry, ways>;
+
+    struct shard final {
+        std::mutex mutex;
+        std::vector<bucket> buckets;
+    };
+
+    [[nodiscard]] std::uint64_t now_ms() const noexcept;
+
+    std::chrono::steady_clock::time_point m_start;
+    std::uint64_t m_window_ms;
+    std::vector<shard> m_shards;
+    std::size_t m_bucket_mask = 0;
+
+    std::atomic<std::uint64_t> m_hits = 0;
+    std::atomic<std::uint64_t> m_misses = 0;
+};
+
+} // namespace linkollector
@@ -0,0 +1,72 @@
+#include "hash.h"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+namespace linkollector {
+
+std::uint64_t hash64(std::string_view data, std::uint64_t seed) noexcept {
+    constexpr std::uint64_t m = 0xc6a4a7935bd1e995ULL;
+    constexpr unsigned int r = 47;
+
+    std::uint64_t h = seed ^ (data.size() * m);
+
+    const auto *current = data.data();
+    const auto block_count = data.size() / sizeof(std::uint64_t);
+
+    for (std::size_t i = 0; i < block_count; ++i) {
+        std::uint64_t k = 0;
+        std::memcpy(&k, current, sizeof(k));
+        current = std::next(current, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    const auto tail_size = data.size() % sizeof(std::uint64_t);
+    for (std::size_t i = tail_size; i > 0; --i) {
+        h ^= std::uint64_t{static_cast<unsigned char>(
+                 *std::next(current, static_cast<std::ptrdiff_t>(i - 1)))}
+             << (8U * (i - 1));
+    }
+    if (tail_size > 0) {
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+constexpr std::array<std::uint32_t, 256> crc32_table = []() {
+    std::array<std::uint32_t, 256> table = {};
+    for (std::uint32_t i = 0; i < table.size(); ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1U) != 0 ? (crc >> 1U) ^ 0xedb88320U : crc >> 1U;
+        }
+        table.at(i) = crc;
+    }
+    return table;
+}();
+
+std::uint32_t
+crc32_update(std::uint32_t crc, gsl::span<const std::byte> bytes) noexcept {
+    crc = ~crc;
+    for (const auto byte : bytes) {
+        crc = crc32_table.at((crc ^ std::to_integer<std::uint32_t>(byte)) &
+                             0xffU) ^
+              (crc >> 8U);
+    }
+    return ~crc;
+}
+
+} // namespace linkollector
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace linkollector {
+
+// Fast non-cryptographic 64-bit hash (MurmurHash64A).
+[[nodiscard]] std::uint64_t hash64(std::string_view data,
+                                   std::uint64_t seed = 0) noexcept;
+
+// Continues a CRC-32 computation; start with crc = 0.
+[[nodiscard]] std::uint32_t
+crc32_update(std::uint32_t crc, gsl::span<const std::byte> bytes) noexcept;
+
+} // namespace linkollector
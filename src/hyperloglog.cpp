@@ -0,0 +1,54 @@
+#include "hyperloglog.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace linkollector {
+
+void hyperloglog::add(std::uint64_t hash) noexcept {
+    const std::size_t index = hash >> (64 - precision);
+
+    // Position of the first set bit among the remaining bits
+    auto rest = hash << precision;
+    std::uint8_t rank = 1;
+    while (rank <= 64 - precision && (rest & (std::uint64_t{1} << 63U)) == 0) {
+        ++rank;
+        rest <<= 1U;
+    }
+
+    auto &register_ = this->m_registers.at(index);
+    register_ = std::max(register_, rank);
+}
+
+double hyperloglog::estimate() const noexcept {
+    constexpr auto m = static_cast<double>(register_count);
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+    double sum = 0.0;
+    std::size_t zero_registers = 0;
+    for (const auto register_ : this->m_registers) {
+        sum += std::ldexp(1.0, -register_);
+        if (register_ == 0) {
+            ++zero_registers;
+        }
+    }
+
+    const double raw = alpha * m * m / sum;
+
+    // Linear counting is more accurate while many registers are empty
+    if (raw <= 2.5 * m && zero_registers > 0) {
+        return m * std::log(m / static_cast<double>(zero_registers));
+    }
+    return raw;
+}
+
+void hyperloglog::merge(const hyperloglog &other) noexcept {
+    for (std::size_t i = 0; i < register_count; ++i) {
+        this->m_registers.at(i) =
+            std::max(this->m_registers.at(i), other.m_registers.at(i));
+    }
+}
+
+void hyperloglog::clear() noexcept { this->m_registers.fill(0); }
+
+} // namespace linkollector
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace linkollector {
+
+// Estimates the number of distinct items from their 64-bit hashes in
+// 2^precision bytes, with a standard error of about 1.04 / 2^(precision/2)
+// (0.8% here).
+class hyperloglog final {
+
+public:
+    static constexpr std::size_t precision = 14;
+    static constexpr std::size_t register_count = std::size_t{1} << precision;
+
+    void add(std::uint64_t hash) noexcept;
+    [[nodiscard]] double estimate() const noexcept;
+
+    void merge(const hyperloglog &other) noexcept;
+    void clear() noexcept;
+
+private:
+    std::array<std::uint8_t, register_count> m_registers = {};
+};
+
+} // namespace linkollector
@@ -0,0 +1,34 @@
+#include "json.h"
+
+namespace linkollector {
+
+template <typename String>
+static void append_quoted(String &out, std::string_view str) {
+    constexpr std::string_view hex_digits = "0123456789abcdef";
+
+    out.push_back('"');
+    for (const char c : str) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (byte < 0x20U) {
+            out.append("\\u00");
+            out.push_back(hex_digits[byte >> 4U]);
+            out.push_back(hex_digits[byte & 0xfU]);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+void append_json_string(std::string &out, std::string_view str) {
+    append_quoted(out, str);
+}
+
+void append_json_string(std::pmr::string &out, std::string_view str) {
+    append_quoted(out, str);
+}
+
+} // namespace linkollector
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+namespace linkollector {
+
+// Appends str as a quoted JSON string. Bytes outside ASCII are copied
+// unchanged, so valid UTF-8 stays valid.
+void append_json_string(std::string &out, std::string_view str);
+void append_json_string(std::pmr::string &out, std::string_view str);
+
+} // namespace linkollector
@@ -0,0 +1,216 @@
+#include "link_analytics.h"
+
+#include "hash.h"
+#include "json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace linkollector {
+
+constexpr std::size_t reported_domains = 10;
+
+link_analytics::window::window() {
+    for (auto &heavy_hitter_ : this->heavy_hitters) {
+        heavy_hitter_.host.reserve(max_host_length);
+    }
+}
+
+void link_analytics::window::reset(std::uint64_t window_id) noexcept {
+    this->id = window_id;
+    this->items = 0;
+    this->hosts.clear();
+    this->links.clear();
+    this->heavy_hitter_size = 0;
+}
+
+// Keeps the heavy_hitter_count hosts with the highest estimates seen so
+// far. The strings were reserved up front, so this never allocates.
+void link_analytics::window::track(std::uint64_t hash,
+                                   std::uint32_t estimate,
+                                   std::string_view host) noexcept {
+    const auto begin = this->heavy_hitters.begin();
+    const auto end =
+        std::next(begin, static_cast<std::ptrdiff_t>(this->heavy_hitter_size));
+
+    const auto found =
+        std::find_if(begin, end, [hash](const heavy_hitter &candidate) {
+            return candidate.hash == hash;
+        });
+    if (found != end) {
+        found->estimate = estimate;
+        return;
+    }
+
+    auto slot = end;
+    if (this->heavy_hitter_size == heavy_hitter_count) {
+        slot = std::min_element(
+            begin, end, [](const heavy_hitter &a, const heavy_hitter &b) {
+                return a.estimate < b.estimate;
+            });
+        if (slot->estimate >= estimate) {
+            return;
+        }
+    } else {
+        ++this->heavy_hitter_size;
+    }
+
+    slot->hash = hash;
+    slot->estimate = estimate;
+    slot->host.assign(host);
+}
+
+link_analytics::link_analytics(unsigned int shard_count,
+                               std::chrono::seconds window_length)
+    : m_window(window_length) {
+    this->m_shards.reserve(shard_count);
+    for (unsigned int i = 0; i < shard_count; ++i) {
+        this->m_shards.push_back(std::make_unique<shard>());
+    }
+}
+
+void link_analytics::add(unsigned int shard_index,
+                         std::string_view url) noexcept {
+    const auto maybe_host = host_of(url);
+    if (!maybe_host.has_value() || maybe_host->size() > max_host_length) {
+        return;
+    }
+
+    // Host names are case-insensitive
+    std::array<char, max_host_length> host_buffer = {};
+    std::transform(maybe_host->begin(),
+                   maybe_host->end(),
+                   host_buffer.begin(),
+                   [](char c) {
+                       return c >= 'A' && c <= 'Z'
+                                  ? static_cast<char>(c - 'A' + 'a')
+                                  : c;
+                   });
+    const std::string_view host(host_buffer.data(), maybe_host->size());
+
+    const auto host_hash = hash64(host);
+    const auto link_hash = hash64(url);
+    const auto id = this->window_id();
+
+    auto &shard_ = *this->m_shards.at(shard_index);
+    const std::lock_guard<std::mutex> lock(shard_.mutex);
+
+    auto &window_ = shard_.windows.at(id & 1U);
+    if (window_.id != id) {
+        window_.reset(id);
+    }
+
+    ++window_.items;
+    window_.links.add(link_hash);
+    window_.track(host_hash, window_.hosts.add(host_hash), host);
+}
+
+std::string link_analytics::to_json() const {
+    const auto id = this->window_id();
+
+    std::string out = "{\"window_seconds\":";
+    out += std::to_string(this->m_window.count());
+    out += ",\"current\":";
+    this->write_window(out, id);
+    out += ",\"previous\":";
+    this->write_window(out, id - 1);
+    out += "}";
+    return out;
+}
+
+std::optional<std::string_view>
+link_analytics::host_of(std::string_view url) noexcept {
+    const auto scheme_end = url.find("://");
+    if (scheme_end != std::string_view::npos) {
+        url.remove_prefix(scheme_end + 3);
+    }
+
+    auto authority = url.substr(0, url.find_first_of("/?#"));
+
+    const auto user_info_end = authority.rfind('@');
+    if (user_info_end != std::string_view::npos) {
+        authority.remove_prefix(user_info_end + 1);
+    }
+
+    // IPv6 literals contain colons, the port follows the bracket
+    const auto host = !authority.empty() && authority.front() == '['
+                          ? authority.substr(0, authority.find(']') + 1)
+                          : authority.substr(0, authority.find(':'));
+
+    if (host.empty()) {
+        return std::nullopt;
+    }
+    return host;
+}
+
+std::uint64_t link_analytics::window_id() const noexcept {
+    const auto since_epoch = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch());
+    return static_cast<std::uint64_t>(since_epoch / this->m_window);
+}
+
+void link_analytics::write_window(std::string &out, std::uint64_t id) const {
+    std::uint64_t items = 0;
+    count_min_sketch hosts;
+    hyperloglog links;
+    std::vector<std::pair<std::uint64_t, std::string>> candidates;
+
+    for (const auto &shard_ : this->m_shards) {
+        const std::lock_guard<std::mutex> lock(shard_->mutex);
+
+        const auto &window_ = shard_->windows.at(id & 1U);
+        if (window_.id != id) {
+            continue;
+        }
+
+        items += window_.items;
+        hosts.merge(window_.hosts);
+        links.merge(window_.links);
+        for (std::size_t i = 0; i < window_.heavy_hitter_size; ++i) {
+            const auto &heavy_hitter_ = window_.heavy_hitters.at(i);
+            candidates.emplace_back(heavy_hitter_.hash, heavy_hitter_.host);
+        }
+    }
+
+    // Shards share hosts, estimate each host once on the merged counts
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+
+    std::vector<std::pair<std::uint32_t, const std::string *>> top;
+    top.reserve(candidates.size());
+    for (const auto &[hash, host] : candidates) {
+        top.emplace_back(hosts.estimate(hash), &host);
+    }
+    const auto reported = std::min(top.size(), reported_domains);
+    std::partial_sort(
+        top.begin(),
+        std::next(top.begin(), static_cast<std::ptrdiff_t>(reported)),
+        top.end(),
+        [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    out += "{\"start\":";
+    out += std::to_string(id * static_cast<std::uint64_t>(
+                                   this->m_window.count()));
+    out += ",\"items\":";
+    out += std::to_string(items);
+    out += ",\"distinct_links\":";
+    out += std::to_string(
+        items == 0 ? 0 : std::llround(links.estimate()));
+    out += ",\"top_domains\":[";
+    for (std::size_t i = 0; i < reported; ++i) {
+        if (i > 0) {
+            out += ",";
+        }
+        out += "{\"host\":";
+        append_json_string(out, *top.at(i).second);
+        out += ",\"count\":";
+        out += std::to_string(top.at(i).first);
+        out += "}";
+    }
+    out += "]}";
+}
+
+} // namespace linkollector
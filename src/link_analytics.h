@@ -0,0 +1,86 @@
+#pragma once
+
+#include "count_min_sketch.h"
+#include "hyperloglog.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace linkollector {
+
+// Per-domain counts and distinct link estimates for received URLs, over
+// tumbling windows aligned to the epoch. Memory is fixed: each shard holds
+// a count-min sketch of hosts, the hosts most frequent so far and a
+// HyperLogLog of links, for the current and the previous window.
+//
+// Each worker updates its own shard, so updates only contend with queries,
+// which merge all shards.
+class link_analytics final {
+
+public:
+    explicit link_analytics(unsigned int shard_count,
+                            std::chrono::seconds window_length);
+    link_analytics(const link_analytics &other) = delete;
+    link_analytics &operator=(const link_analytics &other) = delete;
+    link_analytics(link_analytics &&other) noexcept = delete;
+    link_analytics &operator=(link_analytics &&other) noexcept = delete;
+    ~link_analytics() noexcept = default;
+
+    void add(unsigned int shard_index, std::string_view url) noexcept;
+
+    // The current and previous window as JSON, with the top domains and
+    // the estimated number of distinct links of each.
+    [[nodiscard]] std::string to_json() const;
+
+    // Host part of a URL, without user info and port. The scheme is
+    // optional.
+    [[nodiscard]] static std::optional<std::string_view>
+    host_of(std::string_view url) noexcept;
+
+private:
+    static constexpr std::size_t heavy_hitter_count = 16;
+    static constexpr std::size_t max_host_length = 253;
+
+    struct heavy_hitter final {
+        std::uint64_t hash = 0;
+        std::uint32_t estimate = 0;
+        std::string host;
+    };
+
+    struct window final {
+        std::uint64_t id = 0;
+        std::uint64_t items = 0;
+        count_min_sketch hosts;
+        hyperloglog links;
+        std::size_t heavy_hitter_size = 0;
+        std::array<heavy_hitter, heavy_hitter_count> heavy_hitters;
+
+        explicit window();
+        void reset(std::uint64_t window_id) noexcept;
+        void track(std::uint64_t hash,
+                   std::uint32_t estimate,
+                   std::string_view host) noexcept;
+    };
+
+    struct shard final {
+        mutable std::mutex mutex;
+        // Indexed by the parity of the window id
+        std::array<window, 2> windows;
+    };
+
+    [[nodiscard]] std::uint64_t window_id() const noexcept;
+    void write_window(std::string &out, std::uint64_t id) const;
+
+    std::chrono::seconds m_window;
+    std::vector<std::unique_ptr<shard>> m_shards;
+};
+
+} // namespace linkollector
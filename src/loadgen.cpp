@@ -0,0 +1,501 @@
+#include "loadgen.h"
+
+#include "activity.h"
+#include "metrics.h"
+#include "protocol.h"
+#include "sender.h"
+#include "signal_helper.h"
+#include "wrappers/zmq/context.h"
+#include "wrappers/zmq/message.h"
+#include "wrappers/zmq/poller.h"
+#include "wrappers/zmq/socket.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace linkollector::loadgen {
+
+using clock = std::chrono::steady_clock;
+
+// Requests a thread may have unanswered before it stops sending, so an
+// overloaded responder cannot make it queue without bound. Open-loop
+// latencies still count from the due time, so the stall shows.
+constexpr std::size_t max_outstanding = 64U * 1024U;
+
+// Longest a thread waits before checking whether it should stop
+constexpr std::chrono::milliseconds stop_check_interval(10);
+
+// Payloads are cut from a block of random characters
+constexpr std::size_t text_block_size = 64U * 1024U;
+constexpr std::string_view url_prefix = "https://loadgen.test/";
+
+// Sizes are capped so every payload can be cut from the text block
+constexpr std::size_t max_payload_size = text_block_size / 2;
+
+static std::mutex s_error_mutex;
+
+[[nodiscard]] static std::optional<std::size_t>
+parse_size(std::string_view str) noexcept {
+    std::size_t size = 0;
+    const auto *const end =
+        std::next(str.data(), static_cast<std::ptrdiff_t>(str.size()));
+    const auto [ptr, ec] = std::from_chars(str.data(), end, size);
+    if (ec != std::errc() || ptr != end || size == 0 ||
+        size > max_payload_size) {
+        return std::nullopt;
+    }
+    return size;
+}
+
+std::optional<size_distribution>
+parse_size_distribution(std::string_view str) noexcept {
+    const auto separator = str.find(':');
+    if (separator == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    const auto name = str.substr(0, separator);
+    const auto arguments = str.substr(separator + 1);
+    size_distribution sizes;
+
+    if (name == "fixed" || name == "exponential") {
+        const auto maybe_size = parse_size(arguments);
+        if (!maybe_size.has_value()) {
+            return std::nullopt;
+        }
+        sizes.shape_ = name == "fixed" ? size_distribution::shape::fixed
+                                       : size_distribution::shape::exponential;
+        sizes.first = *maybe_size;
+        sizes.second = *maybe_size;
+        return sizes;
+    }
+
+    if (name == "uniform") {
+        const auto bound_separator = arguments.find(':');
+        if (bound_separator == std::string_view::npos) {
+            return std::nullopt;
+        }
+        const auto maybe_min =
+            parse_size(arguments.substr(0, bound_separator));
+        const auto maybe_max =
+            parse_size(arguments.substr(bound_separator + 1));
+        if (!maybe_min.has_value() || !maybe_max.has_value() ||
+            *maybe_min > *maybe_max) {
+            return std::nullopt;
+        }
+        sizes.shape_ = size_distribution::shape::uniform;
+        sizes.first = *maybe_min;
+        sizes.second = *maybe_max;
+        return sizes;
+    }
+
+    return std::nullopt;
+}
+
+[[nodiscard]] static bool is_local(const std::string &server) noexcept {
+    return server == "localhost" || server.rfind("127.", 0) == 0 ||
+           server.rfind("ipc://", 0) == 0;
+}
+
+// What one client thread saw, merged once it is done
+struct thread_result final {
+    std::uint64_t sent = 0;
+    std::uint64_t acknowledged = 0;
+    std::uint64_t rejected = 0;
+    std::uint64_t unanswered = 0;
+    bool failed = false;
+
+    // From the time a request was due, and from the time it went out.
+    // The two only differ in open loop.
+    histogram latency_ns;
+    histogram response_ns;
+    std::uint64_t max_latency_ns = 0;
+    std::uint64_t max_response_ns = 0;
+};
+
+// Builds items of the configured mix and sizes
+class item_generator final {
+
+public:
+    explicit item_generator(const options &options_,
+                            unsigned int seed) noexcept
+        : m_options(options_), m_random(seed) {
+        constexpr std::string_view alphabet =
+            "abcdefghijklmnopqrstuvwxyz0123456789";
+        std::uniform_int_distribution<std::size_t> pick(0,
+                                                        alphabet.size() - 1);
+        this->m_text.resize(text_block_size);
+        for (auto &character : this->m_text) {
+            character = alphabet[pick(this->m_random)];
+        }
+    }
+
+    [[nodiscard]] activity next_activity() noexcept {
+        std::uniform_int_distribution<unsigned int> percent(0, 99);
+        return percent(this->m_random) < this->m_options.url_percent
+                   ? activity::url
+                   : activity::text;
+    }
+
+    [[nodiscard]] std::string next_payload(activity activity_) {
+        auto size = this->next_size();
+        std::string payload;
+
+        // URLs stay valid for responders that canonicalize them
+        if (activity_ == activity::url) {
+            payload = url_prefix;
+            size = size > url_prefix.size() ? size - url_prefix.size() : 1;
+        }
+
+        std::uniform_int_distribution<std::size_t> offset(
+            0, text_block_size - size);
+        payload.append(this->m_text, offset(this->m_random), size);
+        return payload;
+    }
+
+private:
+    [[nodiscard]] std::size_t next_size() noexcept {
+        const auto &sizes = this->m_options.sizes;
+
+        switch (sizes.shape_) {
+        case size_distribution::shape::fixed: {
+            return sizes.first;
+        }
+        case size_distribution::shape::uniform: {
+            return std::uniform_int_distribution<std::size_t>(
+                sizes.first, sizes.second)(this->m_random);
+        }
+        case size_distribution::shape::exponential: {
+            const auto size = std::exponential_distribution<double>(
+                1.0 / static_cast<double>(sizes.first))(this->m_random);
+            return std::clamp<std::size_t>(
+                static_cast<std::size_t>(size), 1, max_payload_size);
+        }
+        }
+        return sizes.first;
+    }
+
+    const options &m_options;
+    std::minstd_rand m_random;
+    std::string m_text;
+};
+
+static void record(histogram &histogram_,
+                   std::uint64_t &max,
+                   clock::duration elapsed) noexcept {
+    const auto ns = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+            .count());
+    histogram_.record(ns);
+    max = std::max(max, ns);
+}
+
+static void client(wrappers::zmq::context &ctx,
+                   const std::string &server,
+                   const options &options_,
+                   unsigned int index,
+                   const std::atomic<bool> &stopping,
+                   thread_result &result) noexcept {
+    const auto fail = [&result](const char *message) {
+        const std::lock_guard<std::mutex> lock(s_error_mutex);
+        std::cerr << message << "\n";
+        result.failed = true;
+    };
+
+    wrappers::zmq::socket dealer(ctx, wrappers::zmq::socket::type::dealer);
+    wrappers::zmq::poller poller;
+    if (!dealer.connect(sender::endpoint_for(server)) ||
+        !poller.add(dealer, wrappers::zmq::poll_event::in)) {
+        fail("Failed to connect the load generator socket");
+        return;
+    }
+
+    struct request final {
+        clock::time_point due;
+        clock::time_point sent;
+        bool answered;
+    };
+
+    // Request ids count up from the front of the queue
+    std::deque<request> requests;
+    std::uint64_t front_id = 0;
+    std::size_t outstanding = 0;
+
+    item_generator items(options_, index + 1);
+
+    const bool open_loop = options_.rate.has_value();
+    const auto interval =
+        open_loop ? std::max(std::chrono::nanoseconds(
+                                 1000000000LL * options_.thread_count /
+                                 *options_.rate),
+                             std::chrono::nanoseconds(1))
+                  : std::chrono::nanoseconds(0);
+    // Threads are staggered so their schedules interleave
+    auto next_due = clock::now() + interval * index / options_.thread_count;
+
+    // [id] [empty] [header] [payload]: the REP worker hands back every
+    // frame before the delimiter, so answers can be matched to requests
+    const auto send_request = [&](clock::time_point due) {
+        const std::uint64_t id = front_id + requests.size();
+        wrappers::zmq::message id_frame(sizeof(id));
+        std::memcpy(id_frame.data().data(), &id, sizeof(id));
+
+        const auto activity_ = items.next_activity();
+        if (!dealer.blocking_send_more(std::move(id_frame)) ||
+            !dealer.blocking_send_more(wrappers::zmq::message()) ||
+            !sender::send_v2(
+                dealer, activity_, items.next_payload(activity_))) {
+            return false;
+        }
+
+        requests.push_back({due, clock::now(), false});
+        ++outstanding;
+        ++result.sent;
+        return true;
+    };
+
+    wrappers::zmq::message frame;
+
+    // [id] [empty] [status]
+    const auto receive_answer = [&]() {
+        std::optional<std::uint64_t> id;
+        std::optional<protocol::v2::status> status;
+
+        do {
+            if (!dealer.blocking_receive(frame)) {
+                return false;
+            }
+            if (!id.has_value() && frame.size() == sizeof(std::uint64_t)) {
+                id.emplace();
+                std::memcpy(&*id, frame.data().data(), sizeof(*id));
+            } else if (frame.size() == 1) {
+                status = static_cast<protocol::v2::status>(
+                    std::to_integer<std::uint8_t>(frame.data()[0]));
+            }
+        } while (frame.more());
+
+        if (!id.has_value() || *id < front_id ||
+            *id - front_id >= requests.size()) {
+            return true;
+        }
+
+        auto &request_ = requests[*id - front_id];
+        if (request_.answered) {
+            return true;
+        }
+
+        const auto now = clock::now();
+        record(result.latency_ns, result.max_latency_ns, now - request_.due);
+        record(
+            result.response_ns, result.max_response_ns, now - request_.sent);
+        request_.answered = true;
+        --outstanding;
+
+        if (status == protocol::v2::status::ok) {
+            ++result.acknowledged;
+        } else {
+            ++result.rejected;
+        }
+
+        while (!requests.empty() && requests.front().answered) {
+            requests.pop_front();
+            ++front_id;
+        }
+        return true;
+    };
+
+    const auto wait_for_answers = [&](std::chrono::milliseconds timeout) {
+        const auto maybe_responses = poller.wait(timeout);
+        if (!maybe_responses.has_value()) {
+            return false;
+        }
+
+        for (const auto &response : *maybe_responses) {
+            if (response.response_event == wrappers::zmq::poll_event::in &&
+                !receive_answer()) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        auto timeout = stop_check_interval;
+
+        if (open_loop) {
+            // Catches up on every request that fell due while waiting
+            const auto now = clock::now();
+            while (next_due <= now && outstanding < max_outstanding) {
+                if (!send_request(next_due)) {
+                    fail("Failed to send a load generator request");
+                    return;
+                }
+                next_due += interval;
+            }
+
+            // The poller counts in whole milliseconds, so requests go out
+            // up to a millisecond late rather than spinning on a core the
+            // responder could use
+            timeout = std::min(
+                timeout,
+                std::chrono::ceil<std::chrono::milliseconds>(next_due - now));
+        } else {
+            while (outstanding < options_.window) {
+                if (!send_request(clock::now())) {
+                    fail("Failed to send a load generator request");
+                    return;
+                }
+            }
+        }
+
+        if (!wait_for_answers(
+                std::max(timeout, std::chrono::milliseconds(0)))) {
+            fail("Failure in zmq_poller_wait_all, stopping load generator");
+            return;
+        }
+    }
+
+    const auto deadline = clock::now() + options_.timeout;
+    while (outstanding > 0 && clock::now() < deadline) {
+        if (!wait_for_answers(stop_check_interval)) {
+            break;
+        }
+    }
+    result.unanswered = outstanding;
+}
+
+static void print_latency(const char *title,
+                          const histogram &latency,
+                          std::uint64_t max_ns) {
+    if (latency.count() == 0) {
+        return;
+    }
+
+    const auto in_ms = [](std::uint64_t ns) {
+        return static_cast<double>(ns) / 1e6;
+    };
+
+    std::cout << title << " (ms):";
+    for (const auto &[label, quantile] :
+         {std::pair{"p50", 0.5},
+          std::pair{"p90", 0.9},
+          std::pair{"p99", 0.99},
+          std::pair{"p99.9", 0.999},
+          std::pair{"p99.99", 0.9999}}) {
+        std::cout << " " << label << " "
+                  << in_ms(std::min(latency.value_at_quantile(quantile),
+                                    max_ns));
+    }
+    std::cout << ", max " << in_ms(max_ns) << "\n";
+}
+
+int run(wrappers::zmq::context &ctx,
+        const signal_helper::sigint_guard &signals,
+        const std::string &server,
+        const options &options_) noexcept {
+    if (!is_local(server)) {
+        std::cerr << "The load generator only targets a local responder, "
+                     "on localhost, 127.x.x.x or an ipc:// endpoint\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Loading " << server << " from " << options_.thread_count
+              << " threads for " << options_.duration.count() << " s, ";
+    if (options_.rate.has_value()) {
+        std::cout << "open loop at " << *options_.rate << " requests/sec";
+    } else {
+        std::cout << "closed loop with " << options_.window
+                  << " requests in flight per thread";
+    }
+    std::cout << ", " << options_.url_percent << "% URLs\n";
+
+    std::vector<std::unique_ptr<thread_result>> results;
+    results.reserve(options_.thread_count);
+    for (unsigned int i = 0; i < options_.thread_count; ++i) {
+        results.push_back(std::make_unique<thread_result>());
+    }
+
+    std::atomic<bool> stopping = false;
+    const auto start = clock::now();
+
+    std::vector<std::thread> clients;
+    clients.reserve(options_.thread_count);
+    for (unsigned int i = 0; i < options_.thread_count; ++i) {
+        clients.emplace_back(client,
+                             std::ref(ctx),
+                             std::cref(server),
+                             std::cref(options_),
+                             i,
+                             std::cref(stopping),
+                             std::ref(*results.at(i)));
+    }
+
+    // Runs for the duration unless interrupted
+    wrappers::zmq::poller poller;
+    bool interrupted =
+        !poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in);
+    const auto end = start + options_.duration;
+    for (auto now = clock::now(); !interrupted && now < end;
+         now = clock::now()) {
+        const auto maybe_responses = poller.wait(
+            std::chrono::ceil<std::chrono::milliseconds>(end - now));
+        interrupted =
+            !maybe_responses.has_value() || !maybe_responses->empty();
+    }
+
+    stopping.store(true, std::memory_order_relaxed);
+    const auto seconds =
+        std::chrono::duration<double>(clock::now() - start).count();
+
+    for (auto &client_thread : clients) {
+        client_thread.join();
+    }
+
+    thread_result total;
+    for (const auto &result : results) {
+        total.sent += result->sent;
+        total.acknowledged += result->acknowledged;
+        total.rejected += result->rejected;
+        total.unanswered += result->unanswered;
+        total.failed = total.failed || result->failed;
+        total.latency_ns.merge(result->latency_ns);
+        total.response_ns.merge(result->response_ns);
+        total.max_latency_ns =
+            std::max(total.max_latency_ns, result->max_latency_ns);
+        total.max_response_ns =
+            std::max(total.max_response_ns, result->max_response_ns);
+    }
+
+    const auto answered = total.acknowledged + total.rejected;
+    std::cout << "Sent " << total.sent << " items in " << seconds << " s, "
+              << answered << " answered ("
+              << static_cast<double>(answered) / seconds
+              << " answers/sec), " << total.rejected << " rejected, "
+              << total.unanswered << " unanswered\n";
+
+    if (options_.rate.has_value()) {
+        print_latency("Latency from due time", total.latency_ns,
+                      total.max_latency_ns);
+        print_latency("Response time from send", total.response_ns,
+                      total.max_response_ns);
+    } else {
+        print_latency("Latency", total.response_ns, total.max_response_ns);
+    }
+
+    return total.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+} // namespace linkollector::loadgen
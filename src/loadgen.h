@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace wrappers::zmq {
+class context;
+} // namespace wrappers::zmq
+
+namespace linkollector::signal_helper {
+class sigint_guard;
+} // namespace linkollector::signal_helper
+
+// Capacity testing for a responder: several client threads, each with its
+// own socket, send generated items and measure how long answers take.
+//
+// In open loop, requests go out on a fixed schedule whether or not earlier
+// ones were answered, and latency is counted from the time a request was
+// due rather than from when it went out. A responder that stalls then
+// shows the full delay its clients would see, instead of hiding it by
+// holding the sender back (coordinated omission). In closed loop, each
+// thread keeps a fixed number of requests in flight and sends as fast as
+// answers come back.
+namespace linkollector::loadgen {
+
+struct size_distribution final {
+    enum class shape {
+        fixed,
+        // Between first and second, both included
+        uniform,
+        // With mean first
+        exponential,
+    };
+
+    shape shape_ = shape::fixed;
+    std::size_t first = 64;
+    std::size_t second = 64;
+};
+
+// Parses fixed:N, uniform:MIN:MAX or exponential:MEAN, sizes in bytes.
+[[nodiscard]] std::optional<size_distribution>
+parse_size_distribution(std::string_view str) noexcept;
+
+struct options final {
+    unsigned int thread_count = 4;
+
+    // Requests per second over all threads in open loop; without it the
+    // load is closed loop with window requests in flight per thread
+    std::optional<unsigned int> rate;
+    unsigned int window = 1;
+
+    std::chrono::seconds duration{10};
+    // How long to wait for the last answers once sending stops
+    std::chrono::milliseconds timeout{2500};
+
+    // Share of URL items, the rest are texts
+    unsigned int url_percent = 80;
+    size_distribution sizes;
+};
+
+// Only targets a responder on the same machine: server must be a loopback
+// address or an ipc:// endpoint.
+[[nodiscard]] int run(wrappers::zmq::context &ctx,
+                      const signal_helper::sigint_guard &signals,
+                      const std::string &server,
+                      const options &options_) noexcept;
+
+} // namespace linkollector::loadgen
@@ -1,339 +1,900 @@
 #include <algorithm>
-#include <array>
-#include <cctype>
+#include <charconv>
+#include <climits>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <thread>
-#include <tuple>
-
-#include "macros.h"
+#include <vector>
+
+#include "activity.h"
+#include "agent.h"
+#include "loadgen.h"
+#include "outbox.h"
+#include "protocol.h"
+#include "responder.h"
+#include "sender.h"
 #include "signal_helper.h"
+#include "store.h"
 #include "wrappers/zmq/context.h"
-#include "wrappers/zmq/poll.h"
 #include "wrappers/zmq/socket.h"
 
-#include <gsl/span>
-
-enum class activity { url, text };
-
-[[nodiscard]] static std::string
-activity_to_string(activity activity_) noexcept {
-    switch (activity_) {
-    case activity::url: {
-        return "URL";
-    }
-    case activity::text: {
-        return "TEXT";
-    }
+[[nodiscard]] static std::optional<unsigned int>
+parse_count(std::string_view str) noexcept {
+    unsigned int count = 0;
+    const auto *const end =
+        std::next(str.data(), static_cast<std::ptrdiff_t>(str.size()));
+    const auto [ptr, ec] = std::from_chars(str.data(), end, count);
+    if (ec != std::errc() || ptr != end || count == 0) {
+        return std::nullopt;
     }
-    LINKOLLECTOR_UNREACHABLE;
+    return count;
 }
 
-[[nodiscard]] static std::optional<activity>
-activity_from_string(const std::string_view activity_) noexcept {
-    std::string lowercase_activity;
-    std::transform(
-        std::begin(activity_),
-        std::end(activity_),
-        std::back_inserter(lowercase_activity),
-        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    if (lowercase_activity == "url") {
-        return activity::url;
-    }
-    if (lowercase_activity == "text") {
-        return activity::text;
+// Parses a comma-separated list of numbers, zero included.
+[[nodiscard]] static std::optional<std::vector<unsigned int>>
+parse_list(std::string_view str) {
+    std::vector<unsigned int> values;
+
+    while (true) {
+        const auto separator = str.find(',');
+        const auto item = str.substr(0, separator);
+
+        unsigned int value = 0;
+        const auto *const end =
+            std::next(item.data(), static_cast<std::ptrdiff_t>(item.size()));
+        const auto [ptr, ec] = std::from_chars(item.data(), end, value);
+        if (item.empty() || ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        values.push_back(value);
+
+        if (separator == std::string_view::npos) {
+            return values;
+        }
+        str.remove_prefix(separator + 1);
     }
-    return std::nullopt;
 }
 
-constexpr std::string_view activity_delimiter = "\uedfd";
-constexpr std::array<std::byte, activity_delimiter.size()>
-    activity_delimiter_bin = []() {
-        std::array<std::byte, activity_delimiter.size()> delim = {};
-        for (std::size_t i = 0; i < activity_delimiter.size(); ++i) {
-            delim.at(i) = static_cast<std::byte>(activity_delimiter[i]);
-        }
-        return delim;
-    }();
-
-static std::optional<std::pair<activity, std::string>>
-deserialize(gsl::span<std::byte> msg) noexcept {
-    const auto delimiter_begin =
-        std::search(std::begin(msg),
-                    std::end(msg),
-                    std::begin(activity_delimiter_bin),
-                    std::end(activity_delimiter_bin));
-
-    if (delimiter_begin == std::begin(msg) ||
-        delimiter_begin == std::end(msg)) {
+[[nodiscard]] static std::optional<int>
+parse_int(std::string_view str) noexcept {
+    const auto maybe_count = parse_count(str);
+    if (!maybe_count.has_value() ||
+        *maybe_count > static_cast<unsigned int>(INT_MAX)) {
         return std::nullopt;
     }
+    return static_cast<int>(*maybe_count);
+}
 
-    const auto delimiter_end = [&delimiter_begin]() {
-        auto begin_ = delimiter_begin;
-        std::advance(begin_, activity_delimiter.size());
-        return begin_;
-    }();
+int main(int argc, char *argv[]) {
+    wrappers::zmq::socket_options socket_options;
+    std::optional<int> io_threads;
+    std::vector<int> io_thread_cpus;
+
+    // Tuning options precede the mode and apply to every socket
+    int mode_index = 1;
+    for (; mode_index + 1 < argc; ++mode_index) {
+        const std::string_view option(*std::next(argv, mode_index));
+        const std::string_view value(*std::next(argv, mode_index + 1));
+
+        if (option == "--io-threads") {
+            io_threads = parse_int(value);
+            if (!io_threads.has_value()) {
+                std::cerr << "IO thread count must be a positive number\n";
+                return EXIT_FAILURE;
+            }
+        } else if (option == "--io-affinity") {
+            const auto maybe_cpus = parse_list(value);
+            if (!maybe_cpus.has_value()) {
+                std::cerr << "IO thread affinity must be a comma-separated "
+                             "list of CPUs\n";
+                return EXIT_FAILURE;
+            }
+            for (const auto cpu : *maybe_cpus) {
+                io_thread_cpus.push_back(static_cast<int>(cpu));
+            }
+        } else if (option == "--send-hwm" || option == "--receive-hwm") {
+            const auto maybe_messages = parse_int(value);
+            if (!maybe_messages.has_value()) {
+                std::cerr << "High water marks must be a positive number of "
+                             "messages\n";
+                return EXIT_FAILURE;
+            }
+            (option == "--send-hwm" ? socket_options.send_high_water_mark
+                                    : socket_options.receive_high_water_mark) =
+                maybe_messages;
+        } else if (option == "--send-buffer" ||
+                   option == "--receive-buffer") {
+            const auto maybe_size = parse_int(value);
+            if (!maybe_size.has_value() || *maybe_size > INT_MAX / 1024) {
+                std::cerr << "Buffer sizes must be a positive number of "
+                             "KiB\n";
+                return EXIT_FAILURE;
+            }
+            (option == "--send-buffer" ? socket_options.send_buffer_size
+                                       : socket_options.receive_buffer_size) =
+                *maybe_size * 1024;
+        } else if (option == "--keepalive") {
+            const auto maybe_values = parse_list(value);
+            // libzmq takes each value as an int
+            if (!maybe_values.has_value() || maybe_values->size() != 3 ||
+                std::any_of(maybe_values->begin(),
+                            maybe_values->end(),
+                            [](unsigned int keepalive_value) {
+                                return keepalive_value == 0 ||
+                                       keepalive_value >
+                                           static_cast<unsigned int>(INT_MAX);
+                            })) {
+                std::cerr << "Keepalive must be given as "
+                             "IDLE,INTERVAL,COUNT with idle time and "
+                             "interval in seconds, each from 1 to "
+                          << INT_MAX << "\n";
+                return EXIT_FAILURE;
+            }
+            socket_options.keepalive = wrappers::zmq::tcp_keepalive{
+                std::chrono::seconds(maybe_values->at(0)),
+                std::chrono::seconds(maybe_values->at(1)),
+                static_cast<int>(maybe_values->at(2))};
+        } else if (option == "--max-message-size") {
+            const auto maybe_size = parse_count(value);
+            if (!maybe_size.has_value()) {
+                std::cerr << "Maximum message size must be a positive "
+                             "number of MiB\n";
+                return EXIT_FAILURE;
+            }
+            socket_options.max_message_size =
+                std::int64_t{*maybe_size} * 1024 * 1024;
+        } else if (option == "--immediate") {
+            if (value != "on" && value != "off") {
+                std::cerr << "Immediate mode must be on or off\n";
+                return EXIT_FAILURE;
+            }
+            socket_options.immediate = value == "on";
+        } else {
+            break;
+        }
 
-    if (std::distance(delimiter_end, std::end(msg)) == 0) {
-        return std::nullopt;
+        ++mode_index;
     }
 
-    const auto activity_string =
-        std::string(static_cast<char *>(static_cast<void *>(msg.data())),
-                    static_cast<std::size_t>(
-                        std::distance(std::begin(msg), delimiter_begin)));
+    if (mode_index >= argc) {
+        std::cerr << "Need -r, -s, --agent or --loadgen\n";
+        return EXIT_FAILURE;
+    }
 
-    auto maybe_activity = activity_from_string(activity_string);
+    // From here on the mode is the first argument
+    argc -= mode_index - 1;
+    argv = std::next(argv, mode_index - 1);
 
-    if (!maybe_activity.has_value()) {
-        return std::nullopt;
-    }
+    std::string arg1(*std::next(argv));
 
-    auto activity_ = *maybe_activity;
-    auto string_ = std::string(
-        static_cast<char *>(static_cast<void *>(&(*delimiter_end))),
-        static_cast<std::size_t>(std::distance(delimiter_end, std::end(msg))));
+    wrappers::zmq::context ctx;
 
-    return {std::make_pair(activity_, std::move(string_))};
-}
+    if ((io_threads.has_value() && !ctx.set_io_threads(*io_threads)) ||
+        !ctx.set_io_thread_affinity(io_thread_cpus)) {
+        std::cerr << "Failed to configure the IO threads\n";
+        return EXIT_FAILURE;
+    }
+    if (!ctx.set_socket_options(socket_options)) {
+        std::cerr << "Failed to apply the socket options\n";
+        return EXIT_FAILURE;
+    }
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        std::cerr << "Need -r or -s\n";
+    linkollector::signal_helper::sigint_guard signals;
+    if (!signals.is_valid()) {
+        std::cerr << "Failed to set up the SIGINT/SIGTERM handler\n";
         return EXIT_FAILURE;
     }
 
-    std::string arg1(*std::next(argv));
+    if (arg1 == "-r") {
+        linkollector::responder::options options;
+        options.worker_count =
+            std::max(std::thread::hardware_concurrency(), 1U);
+        std::optional<std::string> dump_directory;
+
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view option(*std::next(argv, i));
+
+            if (option == "--threads" && i + 1 < argc) {
+                const auto maybe_count = parse_count(*std::next(argv, ++i));
+                if (!maybe_count.has_value()) {
+                    std::cerr << "Thread count must be a positive number\n";
+                    return EXIT_FAILURE;
+                }
+                options.worker_count = *maybe_count;
+                continue;
+            }
 
-    wrappers::zmq::context ctx;
+            if (option == "--format" && i + 1 < argc) {
+                const std::string_view format(*std::next(argv, ++i));
+                if (format == "text") {
+                    options.output_format = linkollector::sink::format::text;
+                } else if (format == "json") {
+                    options.output_format =
+                        linkollector::sink::format::json_lines;
+                } else {
+                    std::cerr << "Output format must be text or json\n";
+                    return EXIT_FAILURE;
+                }
+                continue;
+            }
 
-    linkollector::signal_helper::sigint_guard guard(
-        static_cast<void *>(&ctx), [](void *data) {
-            wrappers::zmq::context &ctx_ =
-                *static_cast<wrappers::zmq::context *>(data);
-            wrappers::zmq::socket signal_socket(
-                ctx_, wrappers::zmq::socket::type::pair);
+            if (option == "--output-file" && i + 1 < argc) {
+                options.output_target = linkollector::sink::target::file;
+                options.output_path = *std::next(argv, ++i);
+                continue;
+            }
 
-            if (signal_socket.connect("inproc://signal")) {
-                [[maybe_unused]] const bool result =
-                    signal_socket.blocking_send();
+            if (option == "--output-pipe" && i + 1 < argc) {
+                options.output_target = linkollector::sink::target::named_pipe;
+                options.output_path = *std::next(argv, ++i);
+                continue;
             }
-        });
 
-    wrappers::zmq::socket signal_socket(ctx,
-                                        wrappers::zmq::socket::type::pair);
-    if (!signal_socket.bind("inproc://signal")) {
-        std::cerr << "Failed to bind the SIGINT/SIGTERM socket\n";
-        return EXIT_FAILURE;
-    }
+            if (option == "--streams" && i + 1 < argc) {
+                options.stream_directory = *std::next(argv, ++i);
+                continue;
+            }
 
-    if (arg1 == "-r") {
-        wrappers::zmq::socket tcp_responder_socket(
-            ctx, wrappers::zmq::socket::type::rep);
-        if (!tcp_responder_socket.bind("tcp://*:17729")) {
-            std::cerr << "Failed to bind the TCP responder socket\n";
-            return EXIT_FAILURE;
-        }
+            if (option == "--stream-timeout" && i + 1 < argc) {
+                const auto maybe_timeout = parse_count(*std::next(argv, ++i));
+                if (!maybe_timeout.has_value()) {
+                    std::cerr << "Stream timeout must be a positive number "
+                                 "of seconds\n";
+                    return EXIT_FAILURE;
+                }
+                options.stream_idle_timeout =
+                    std::chrono::seconds(*maybe_timeout);
+                continue;
+            }
 
-        std::cout << "Press CTRL+C to cancel..." << std::endl;
+            if (option == "--output-queue" && i + 1 < argc) {
+                const auto maybe_capacity = parse_count(*std::next(argv, ++i));
+                if (!maybe_capacity.has_value()) {
+                    std::cerr << "Output queue capacity must be a positive "
+                                 "number of items\n";
+                    return EXIT_FAILURE;
+                }
+                options.output_queue_capacity = *maybe_capacity;
+                continue;
+            }
 
-        std::array<wrappers::zmq::poll_target, 2> items = {
-            wrappers::zmq::poll_target(signal_socket,
-                                       wrappers::zmq::poll_event::in),
-            wrappers::zmq::poll_target(tcp_responder_socket,
-                                       wrappers::zmq::poll_event::in),
-        };
+            if (option == "--output-wait" && i + 1 < argc) {
+                const std::string_view strategy(*std::next(argv, ++i));
+                if (strategy == "block") {
+                    options.output_wait = linkollector::wait_strategy::block;
+                } else if (strategy == "spin") {
+                    options.output_wait = linkollector::wait_strategy::spin;
+                } else {
+                    std::cerr << "Output wait must be block or spin\n";
+                    return EXIT_FAILURE;
+                }
+                continue;
+            }
 
-        bool break_loop = false;
+            if (option == "--output-overflow" && i + 1 < argc) {
+                const std::string_view policy(*std::next(argv, ++i));
+                if (policy == "wait") {
+                    options.output_overflow =
+                        linkollector::overflow_policy::wait;
+                } else if (policy == "drop") {
+                    options.output_overflow =
+                        linkollector::overflow_policy::drop;
+                } else {
+                    std::cerr << "Output overflow must be wait or drop\n";
+                    return EXIT_FAILURE;
+                }
+                continue;
+            }
 
-        while (!break_loop) {
-            auto maybe_responses = wrappers::zmq::blocking_poll(items);
+            if (option == "--canonicalize-urls") {
+                options.canonicalize_urls = true;
+                continue;
+            }
 
-            if (!maybe_responses.has_value()) {
-                std::cerr << "Failure in zmq_poll, killing server...\n";
-                break;
+            if (option == "--dedup-window" && i + 1 < argc) {
+                const auto maybe_window = parse_count(*std::next(argv, ++i));
+                if (!maybe_window.has_value()) {
+                    std::cerr << "Dedup window must be a positive number of "
+                                 "seconds\n";
+                    return EXIT_FAILURE;
+                }
+                options.dedup_window = std::chrono::seconds(*maybe_window);
+                continue;
+            }
+
+            if (option == "--dedup-memory" && i + 1 < argc) {
+                const auto maybe_memory = parse_count(*std::next(argv, ++i));
+                if (!maybe_memory.has_value()) {
+                    std::cerr << "Dedup memory must be a positive number of "
+                                 "MiB\n";
+                    return EXIT_FAILURE;
+                }
+                options.dedup_memory =
+                    std::size_t{*maybe_memory} * 1024U * 1024U;
+                continue;
+            }
+
+            if (option == "--store" && i + 1 < argc) {
+                options.store_directory = *std::next(argv, ++i);
+                continue;
+            }
+
+            if (option == "--segment-size" && i + 1 < argc) {
+                const auto maybe_size = parse_count(*std::next(argv, ++i));
+                if (!maybe_size.has_value()) {
+                    std::cerr << "Segment size must be a positive number of "
+                                 "MiB\n";
+                    return EXIT_FAILURE;
+                }
+                options.store_segment_size =
+                    std::uint64_t{*maybe_size} * 1024U * 1024U;
+                continue;
+            }
+
+            if (option == "--sync-acks") {
+                options.store_sync_acks = true;
+                continue;
+            }
+
+            if (option == "--fsync-interval" && i + 1 < argc) {
+                const auto maybe_interval = parse_count(*std::next(argv, ++i));
+                if (!maybe_interval.has_value()) {
+                    std::cerr << "Fsync interval must be a positive number of "
+                                 "milliseconds\n";
+                    return EXIT_FAILURE;
+                }
+                options.store_fsync_interval =
+                    std::chrono::milliseconds(*maybe_interval);
+                continue;
             }
 
-            const auto responses = std::move(*maybe_responses);
+            if (option == "--publish" && i + 1 < argc) {
+                options.publish_endpoint = *std::next(argv, ++i);
+                continue;
+            }
 
-            if (responses.empty()) {
+            if (option == "--analytics-port" && i + 1 < argc) {
+                const auto maybe_port = parse_count(*std::next(argv, ++i));
+                if (!maybe_port.has_value() || *maybe_port > UINT16_MAX) {
+                    std::cerr << "Analytics port must be between 1 and "
+                                 "65535\n";
+                    return EXIT_FAILURE;
+                }
+                options.analytics_port =
+                    static_cast<std::uint16_t>(*maybe_port);
                 continue;
             }
 
-            for (const auto &response : responses) {
-                if (response.response_socket == &signal_socket &&
-                    response.response_event == wrappers::zmq::poll_event::in) {
-                    if (!signal_socket.blocking_receive()) {
-                        std::cerr
-                            << "Failed to receive answer from signal socket\n";
-                    }
-                    break_loop = true;
-                    break;
+            if (option == "--analytics-window" && i + 1 < argc) {
+                const auto maybe_window = parse_count(*std::next(argv, ++i));
+                if (!maybe_window.has_value()) {
+                    std::cerr << "Analytics window must be a positive number "
+                                 "of seconds\n";
+                    return EXIT_FAILURE;
                 }
+                options.analytics_window =
+                    std::chrono::seconds(*maybe_window);
+                continue;
+            }
 
-                if (response.response_socket == &tcp_responder_socket &&
-                    response.response_event == wrappers::zmq::poll_event::in) {
-                    using payload_t = std::tuple<
-                        wrappers::zmq::socket &,
-                        std::optional<std::pair<activity, std::string>> &,
-                        bool &>;
-
-                    std::optional<std::pair<activity, std::string>> maybe_data;
-                    bool did_error = false;
-
-                    payload_t payload(
-                        tcp_responder_socket, maybe_data, did_error);
-
-                    const auto on_message = [](void *payload_,
-                                               gsl::span<std::byte> msg) {
-                        auto &[tcp_responder_socket_,
-                               maybe_data_,
-                               did_error_] =
-                            *static_cast<payload_t *>(payload_);
-
-                        if (!tcp_responder_socket_.blocking_send()) {
-                            std::cerr << "Failed to send data to the TCP "
-                                         "responder socket\n";
-                            did_error_ = true;
-                            return;
-                        }
-
-                        if (msg.empty()) {
-                            return;
-                        }
-
-                        maybe_data_ = deserialize(msg);
-                    };
-
-                    if (did_error) {
-                        break_loop = true;
-                        break;
-                    }
-
-                    if (!tcp_responder_socket.async_receive(
-                            static_cast<void *>(&payload), on_message)) {
-                        std::cerr
-                            << "Failure in zmq_msg_recv, killing server...\n";
-                        break_loop = true;
-                        break;
-                    }
-
-                    if (!maybe_data.has_value()) {
-                        std::cout << "Could not parse message from client\n";
-                        continue;
-                    }
-
-                    auto data = std::move(*maybe_data);
-                    const auto activity_ = data.first;
-                    const auto string_ = std::move(data.second);
-
-                    std::cout << "Received " << activity_to_string(activity_)
-                              << ":\n" << string_ << "\n";
+            if (option == "--stats-port" && i + 1 < argc) {
+                const auto maybe_port = parse_count(*std::next(argv, ++i));
+                if (!maybe_port.has_value() || *maybe_port > UINT16_MAX) {
+                    std::cerr << "Stats port must be between 1 and 65535\n";
+                    return EXIT_FAILURE;
                 }
+                options.stats_port = static_cast<std::uint16_t>(*maybe_port);
+                continue;
+            }
+
+            if (option == "--metrics-file" && i + 1 < argc) {
+                options.metrics_file = *std::next(argv, ++i);
+                continue;
+            }
+
+            if (option == "--trace" && i + 1 < argc) {
+                options.trace_path = *std::next(argv, ++i);
+                continue;
+            }
+
+            if (option == "--drain-timeout" && i + 1 < argc) {
+                const auto maybe_timeout = parse_count(*std::next(argv, ++i));
+                if (!maybe_timeout.has_value()) {
+                    std::cerr << "Drain timeout must be a positive number of "
+                                 "milliseconds\n";
+                    return EXIT_FAILURE;
+                }
+                options.drain_timeout =
+                    std::chrono::milliseconds(*maybe_timeout);
+                continue;
+            }
+
+            if (option == "--ipc" && i + 1 < argc) {
+                options.ipc_endpoint =
+                    "ipc://" + std::string(*std::next(argv, ++i));
+                continue;
+            }
+
+            if (option == "--metrics-interval" && i + 1 < argc) {
+                const auto maybe_interval = parse_count(*std::next(argv, ++i));
+                if (!maybe_interval.has_value()) {
+                    std::cerr << "Metrics interval must be a positive number "
+                                 "of seconds\n";
+                    return EXIT_FAILURE;
+                }
+                options.metrics_interval =
+                    std::chrono::seconds(*maybe_interval);
+                continue;
+            }
+
+            if (option == "--dump" && i + 1 < argc) {
+                dump_directory = *std::next(argv, ++i);
+                continue;
+            }
+
+            std::cerr << "Unknown option " << option << "\n";
+            return EXIT_FAILURE;
+        }
+
+        if (dump_directory.has_value()) {
+            const auto print_record =
+                [](void *, const linkollector::store::record &record_) {
+                    std::cout << "#" << record_.sequence << " "
+                              << record_.timestamp_us << " "
+                              << linkollector::activity_to_string(
+                                     record_.record_activity)
+                              << ":\n"
+                              << record_.payload << "\n";
+                };
+
+            if (!linkollector::store::for_each_record(
+                    *dump_directory, nullptr, print_record)) {
+                std::cerr << "No link store in " << *dump_directory << "\n";
+                return EXIT_FAILURE;
             }
+            return EXIT_SUCCESS;
         }
+
+        return linkollector::responder::run(ctx, signals, options);
     }
 
     else if (arg1 == "-s") {
-        if (argc < 5) {
-            std::cerr << "Need a server name, a message type (url or text) "
-                         "and a message to send\n";
+        unsigned int protocol_version = linkollector::protocol::v2::version;
+        std::optional<std::string> batch_path;
+        char batch_delimiter = '\n';
+        unsigned int batch_window = 64;
+        std::size_t chunk_size = 256U * 1024U;
+        bool use_agent = true;
+        std::optional<std::string> outbox_path;
+        std::chrono::milliseconds timeout(2500);
+        unsigned int attempts = 5;
+        bool report_latency = false;
+        bool trace = false;
+        auto balance_policy =
+            linkollector::balancer::policy::least_outstanding;
+
+        // Options precede the positional arguments
+        int i = 2;
+        for (; i < argc; ++i) {
+            const std::string_view option(*std::next(argv, i));
+
+            if (option.substr(0, 2) != "--") {
+                break;
+            }
+
+            if (option == "--protocol" && i + 1 < argc) {
+                const auto maybe_version = parse_count(*std::next(argv, ++i));
+                if (!maybe_version.has_value() ||
+                    *maybe_version > linkollector::protocol::v2::version) {
+                    std::cerr << "Protocol version must be 1 or 2\n";
+                    return EXIT_FAILURE;
+                }
+                protocol_version = *maybe_version;
+                continue;
+            }
+
+            if (option == "--batch" && i + 1 < argc) {
+                batch_path = *std::next(argv, ++i);
+                continue;
+            }
+
+            if (option == "--window" && i + 1 < argc) {
+                const auto maybe_window = parse_count(*std::next(argv, ++i));
+                if (!maybe_window.has_value()) {
+                    std::cerr << "Window must be a positive number\n";
+                    return EXIT_FAILURE;
+                }
+                batch_window = *maybe_window;
+                continue;
+            }
+
+            if (option == "--chunk-size" && i + 1 < argc) {
+                const auto maybe_size = parse_count(*std::next(argv, ++i));
+                if (!maybe_size.has_value()) {
+                    std::cerr << "Chunk size must be a positive number of "
+                                 "KiB\n";
+                    return EXIT_FAILURE;
+                }
+                chunk_size = std::size_t{*maybe_size} * 1024U;
+                continue;
+            }
+
+            if (option == "--direct") {
+                use_agent = false;
+                continue;
+            }
+
+            if (option == "--null") {
+                batch_delimiter = '\0';
+                continue;
+            }
+
+            if (option == "--balance" && i + 1 < argc) {
+                const std::string_view policy(*std::next(argv, ++i));
+                if (policy == "least-outstanding") {
+                    balance_policy =
+                        linkollector::balancer::policy::least_outstanding;
+                } else if (policy == "round-robin") {
+                    balance_policy =
+                        linkollector::balancer::policy::round_robin;
+                } else {
+                    std::cerr << "Balance policy must be least-outstanding or "
+                                 "round-robin\n";
+                    return EXIT_FAILURE;
+                }
+                continue;
+            }
+
+            if (option == "--latency") {
+                report_latency = true;
+                continue;
+            }
+
+            if (option == "--trace") {
+                trace = true;
+                continue;
+            }
+
+            if (option == "--outbox" && i + 1 < argc) {
+                outbox_path = *std::next(argv, ++i);
+                continue;
+            }
+
+            if (option == "--timeout" && i + 1 < argc) {
+                const auto maybe_timeout = parse_count(*std::next(argv, ++i));
+                if (!maybe_timeout.has_value()) {
+                    std::cerr << "Timeout must be a positive number of "
+                                 "milliseconds\n";
+                    return EXIT_FAILURE;
+                }
+                timeout = std::chrono::milliseconds(*maybe_timeout);
+                continue;
+            }
+
+            if (option == "--attempts" && i + 1 < argc) {
+                const auto maybe_attempts = parse_count(*std::next(argv, ++i));
+                if (!maybe_attempts.has_value()) {
+                    std::cerr << "Attempts must be a positive number\n";
+                    return EXIT_FAILURE;
+                }
+                attempts = *maybe_attempts;
+                continue;
+            }
+
+            std::cerr << "Unknown option " << option << "\n";
+            return EXIT_FAILURE;
+        }
+
+        const int positional_count = batch_path.has_value() ? 2 : 3;
+
+        // With an outbox, a server alone delivers what is already queued
+        const bool drain_only = outbox_path.has_value() && argc - i == 1;
+
+        if (!drain_only && argc - i != positional_count) {
+            if (batch_path.has_value()) {
+                std::cerr << "Need a server name and a message type (url or "
+                             "text) for the batch\n";
+            } else {
+                std::cerr << "Need a server name, a message type (url or "
+                             "text) and a message to send\n";
+            }
             return EXIT_FAILURE;
         }
 
-        std::string server(*std::next(argv, 2));
-        auto maybe_activity = activity_from_string(*std::next(argv, 3));
-        std::string message(*std::next(argv, 4));
+        std::string server(*std::next(argv, i));
+        const auto maybe_servers = linkollector::sender::parse_servers(server);
 
-        if (server.empty()) {
+        if (!maybe_servers.has_value()) {
             std::cerr << "Server cannot be empty\n";
             return EXIT_FAILURE;
         }
 
+        const bool single_server = maybe_servers->size() == 1;
+
+        if (outbox_path.has_value()) {
+            if (!single_server) {
+                std::cerr << "An outbox is kept for a single server\n";
+                return EXIT_FAILURE;
+            }
+
+            if (batch_path.has_value() ||
+                protocol_version != linkollector::protocol::v2::version) {
+                std::cerr << "The outbox takes single items sent with "
+                             "protocol 2\n";
+                return EXIT_FAILURE;
+            }
+
+            linkollector::outbox outbox_(*outbox_path);
+            if (!outbox_.open()) {
+                std::cerr << "Failed to open the outbox " << *outbox_path
+                          << "\n";
+                return EXIT_FAILURE;
+            }
+
+            if (!drain_only) {
+                const auto maybe_item_activity =
+                    linkollector::activity_from_string(
+                        *std::next(argv, i + 1));
+                const std::string_view message(*std::next(argv, i + 2));
+
+                if (!maybe_item_activity.has_value() || message.empty()) {
+                    std::cerr << "Need a message type (url or text) and a "
+                                 "message to queue\n";
+                    return EXIT_FAILURE;
+                }
+
+                if (!outbox_.append(*maybe_item_activity, message)) {
+                    std::cerr << "Failed to append to the outbox "
+                              << *outbox_path << "\n";
+                    return EXIT_FAILURE;
+                }
+
+                std::cout << "Queued "
+                          << linkollector::activity_to_string(
+                                 *maybe_item_activity)
+                          << " \"" << message << "\" in " << *outbox_path
+                          << "\n";
+            }
+
+            return linkollector::sender::send_outbox(ctx,
+                                                     signals,
+                                                     server,
+                                                     outbox_,
+                                                     timeout,
+                                                     batch_window,
+                                                     attempts);
+        }
+
+        auto maybe_activity =
+            linkollector::activity_from_string(*std::next(argv, i + 1));
+
         if (!maybe_activity.has_value()) {
             std::cerr << "Message type must be url or text\n";
             return EXIT_FAILURE;
         }
 
+        if (batch_path.has_value()) {
+            if (protocol_version != linkollector::protocol::v2::version) {
+                std::cerr << "Batches are only sent with protocol 2\n";
+                return EXIT_FAILURE;
+            }
+
+            if (*batch_path == "-") {
+                return linkollector::sender::send_batch(ctx,
+                                                        signals,
+                                                        *maybe_servers,
+                                                        balance_policy,
+                                                        *maybe_activity,
+                                                        std::cin,
+                                                        batch_delimiter,
+                                                        batch_window,
+                                                        timeout,
+                                                        attempts,
+                                                        report_latency,
+                                                        trace);
+            }
+
+            std::ifstream batch_file(*batch_path, std::ios::binary);
+            if (!batch_file) {
+                std::cerr << "Could not open " << *batch_path << "\n";
+                return EXIT_FAILURE;
+            }
+
+            return linkollector::sender::send_batch(ctx,
+                                                    signals,
+                                                    *maybe_servers,
+                                                    balance_policy,
+                                                    *maybe_activity,
+                                                    batch_file,
+                                                    batch_delimiter,
+                                                    batch_window,
+                                                    timeout,
+                                                    attempts,
+                                                    report_latency,
+                                                    trace);
+        }
+
+        std::string message(*std::next(argv, i + 2));
+
         if (message.empty()) {
             std::cerr << "Message cannot be empty\n";
             return EXIT_FAILURE;
         }
 
-        wrappers::zmq::socket tcp_requester_socket(
-            ctx, wrappers::zmq::socket::type::req);
-        if (!tcp_requester_socket.connect("tcp://" + server + ":17729")) {
-            std::cerr << "Failed to connect the TCP requester socket\n";
-            return EXIT_FAILURE;
-        }
+        // Texts given as @file are streamed in chunks
+        if (*maybe_activity == linkollector::activity::text &&
+            message.front() == '@') {
+            if (!single_server) {
+                std::cerr << "Files are streamed to a single server\n";
+                return EXIT_FAILURE;
+            }
 
-        std::string data;
-        data += activity_to_string(*maybe_activity);
-        data += activity_delimiter;
-        data += message;
+            if (protocol_version != linkollector::protocol::v2::version) {
+                std::cerr << "Files are only streamed with protocol 2\n";
+                return EXIT_FAILURE;
+            }
 
-        if (!tcp_requester_socket.blocking_send(
-                {static_cast<std::byte *>(static_cast<void *>(data.data())),
-                 data.size()})) {
-            std::cerr << "Failed to send data to the TCP requester socket\n";
-            return EXIT_FAILURE;
+            const auto path = message.substr(1);
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file) {
+                std::cerr << "Could not open " << path << "\n";
+                return EXIT_FAILURE;
+            }
+
+            const auto size = static_cast<std::uint64_t>(file.tellg());
+            if (size == 0 || !file.seekg(0)) {
+                std::cerr << "Cannot stream empty or unseekable file " << path
+                          << "\n";
+                return EXIT_FAILURE;
+            }
+
+            return linkollector::sender::send_stream(ctx,
+                                                     signals,
+                                                     server,
+                                                     *maybe_activity,
+                                                     file,
+                                                     size,
+                                                     chunk_size,
+                                                     batch_window,
+                                                     timeout);
+        }
+
+        // A running agent already holds a connection to the server
+        if (use_agent && single_server && !trace &&
+            protocol_version == linkollector::protocol::v2::version) {
+            const auto maybe_rc = linkollector::agent::send(
+                ctx, server, *maybe_activity, message);
+            if (maybe_rc.has_value()) {
+                return *maybe_rc;
+            }
         }
 
-        std::cout << "Sending " << activity_to_string(*maybe_activity) << " \""
-                  << message << "\" to hello world server...\n";
+        return linkollector::sender::send(ctx,
+                                          signals,
+                                          *maybe_servers,
+                                          *maybe_activity,
+                                          message,
+                                          protocol_version,
+                                          timeout,
+                                          attempts,
+                                          trace);
+    }
 
-        std::array<wrappers::zmq::poll_target, 2> items = {
-            wrappers::zmq::poll_target(signal_socket,
-                                       wrappers::zmq::poll_event::in),
-            wrappers::zmq::poll_target(tcp_requester_socket,
-                                       wrappers::zmq::poll_event::in),
-        };
+    else if (arg1 == "--agent") {
+        const std::vector<std::string> servers(std::next(argv, 2),
+                                               std::next(argv, argc));
+        return linkollector::agent::run(ctx, signals, servers);
+    }
 
-        bool break_loop = false;
+    else if (arg1 == "--loadgen") {
+        linkollector::loadgen::options options;
 
-        while (!break_loop) {
-            auto maybe_responses = wrappers::zmq::blocking_poll(items);
+        // Options precede the server
+        int i = 2;
+        for (; i < argc; ++i) {
+            const std::string_view option(*std::next(argv, i));
 
-            if (!maybe_responses.has_value()) {
-                std::cerr << "Failure in zmq_poll, killing client...\n";
+            if (option.substr(0, 2) != "--") {
                 break;
             }
 
-            const auto responses = std::move(*maybe_responses);
+            if (option == "--threads" && i + 1 < argc) {
+                const auto maybe_count = parse_count(*std::next(argv, ++i));
+                if (!maybe_count.has_value()) {
+                    std::cerr << "Thread count must be a positive number\n";
+                    return EXIT_FAILURE;
+                }
+                options.thread_count = *maybe_count;
+                continue;
+            }
 
-            if (responses.empty()) {
+            if (option == "--rate" && i + 1 < argc) {
+                const auto maybe_rate = parse_count(*std::next(argv, ++i));
+                if (!maybe_rate.has_value()) {
+                    std::cerr << "Rate must be a positive number of requests "
+                                 "per second\n";
+                    return EXIT_FAILURE;
+                }
+                options.rate = *maybe_rate;
                 continue;
             }
 
-            for (const auto &response : responses) {
-                if (response.response_socket == &signal_socket &&
-                    response.response_event == wrappers::zmq::poll_event::in) {
+            if (option == "--window" && i + 1 < argc) {
+                const auto maybe_window = parse_count(*std::next(argv, ++i));
+                if (!maybe_window.has_value()) {
+                    std::cerr << "Window must be a positive number\n";
+                    return EXIT_FAILURE;
+                }
+                options.window = *maybe_window;
+                continue;
+            }
 
-                    if (!signal_socket.blocking_receive()) {
-                        std::cerr
-                            << "Failed to receive answer from signal socket\n";
-                    }
-                    break_loop = true;
-                    break;
+            if (option == "--duration" && i + 1 < argc) {
+                const auto maybe_duration = parse_count(*std::next(argv, ++i));
+                if (!maybe_duration.has_value()) {
+                    std::cerr << "Duration must be a positive number of "
+                                 "seconds\n";
+                    return EXIT_FAILURE;
                 }
+                options.duration = std::chrono::seconds(*maybe_duration);
+                continue;
+            }
 
-                if (response.response_socket == &tcp_requester_socket &&
-                    response.response_event == wrappers::zmq::poll_event::in) {
+            if (option == "--timeout" && i + 1 < argc) {
+                const auto maybe_timeout = parse_count(*std::next(argv, ++i));
+                if (!maybe_timeout.has_value()) {
+                    std::cerr << "Timeout must be a positive number of "
+                                 "milliseconds\n";
+                    return EXIT_FAILURE;
+                }
+                options.timeout = std::chrono::milliseconds(*maybe_timeout);
+                continue;
+            }
 
-                    if (!tcp_requester_socket.async_receive(nullptr,
-                                                            nullptr)) {
-                        std::cerr
-                            << "Failure in zmq_msg_recv, killing client...\n";
-                    }
+            if (option == "--url-percent" && i + 1 < argc) {
+                const std::string_view value(*std::next(argv, ++i));
+                const auto maybe_percent = parse_count(value);
+                if (value != "0" &&
+                    (!maybe_percent.has_value() || *maybe_percent > 100)) {
+                    std::cerr << "URL percent must be between 0 and 100\n";
+                    return EXIT_FAILURE;
+                }
+                options.url_percent = maybe_percent.value_or(0);
+                continue;
+            }
 
-                    break_loop = true;
-                    break;
+            if (option == "--sizes" && i + 1 < argc) {
+                const auto maybe_sizes =
+                    linkollector::loadgen::parse_size_distribution(
+                        *std::next(argv, ++i));
+                if (!maybe_sizes.has_value()) {
+                    std::cerr << "Sizes must be fixed:N, uniform:MIN:MAX or "
+                                 "exponential:MEAN, in bytes\n";
+                    return EXIT_FAILURE;
                 }
+                options.sizes = *maybe_sizes;
+                continue;
             }
+
+            std::cerr << "Unknown option " << option << "\n";
+            return EXIT_FAILURE;
         }
+
+        if (i + 1 != argc) {
+            std::cerr << "Need one server to load\n";
+            return EXIT_FAILURE;
+        }
+
+        return linkollector::loadgen::run(
+            ctx, signals, *std::next(argv, i), options);
     }
 
     else {
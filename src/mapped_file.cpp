@@ -0,0 +1,139 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace linkollector {
+
+mapped_file::mapped_file(const std::string &path) noexcept {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    this->m_open = true;
+    this->m_size = static_cast<std::size_t>(size.QuadPart);
+
+    if (this->m_size == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        this->m_open = false;
+        this->m_size = 0;
+        return;
+    }
+
+    this->m_data = static_cast<const std::byte *>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (this->m_data == nullptr) {
+        this->m_open = false;
+        this->m_size = 0;
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat file_stat = {};
+    if (::fstat(fd, &file_stat) == -1) {
+        ::close(fd);
+        return;
+    }
+
+    this->m_open = true;
+    this->m_size = static_cast<std::size_t>(file_stat.st_size);
+
+    if (this->m_size == 0) {
+        ::close(fd);
+        return;
+    }
+
+    void *mapping =
+        ::mmap(nullptr, this->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        this->m_open = false;
+        this->m_size = 0;
+        return;
+    }
+
+    ::madvise(mapping, this->m_size, MADV_SEQUENTIAL);
+    this->m_data = static_cast<const std::byte *>(mapping);
+#endif
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+    : m_data(other.m_data), m_size(other.m_size), m_open(other.m_open) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_open = false;
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+    if (this != &other) {
+        this->close();
+
+        this->m_data = other.m_data;
+        this->m_size = other.m_size;
+        this->m_open = other.m_open;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_open = false;
+    }
+
+    return *this;
+}
+
+mapped_file::~mapped_file() noexcept {
+    this->close();
+}
+
+bool mapped_file::is_open() const noexcept {
+    return this->m_open;
+}
+
+gsl::span<const std::byte> mapped_file::data() const noexcept {
+    return {this->m_data, this->m_data == nullptr ? 0 : this->m_size};
+}
+
+void mapped_file::close() noexcept {
+    if (this->m_data != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(this->m_data);
+#else
+        ::munmap(const_cast<std::byte *>(this->m_data), this->m_size);
+#endif
+    }
+
+    this->m_data = nullptr;
+    this->m_size = 0;
+    this->m_open = false;
+}
+
+} // namespace linkollector
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <gsl/span>
+
+namespace linkollector {
+
+// Read-only memory mapping of a whole file.
+class mapped_file final {
+
+public:
+    explicit mapped_file(const std::string &path) noexcept;
+    mapped_file(const mapped_file &other) = delete;
+    mapped_file &operator=(const mapped_file &other) = delete;
+    mapped_file(mapped_file &&other) noexcept;
+    mapped_file &operator=(mapped_file &&other) noexcept;
+    ~mapped_file() noexcept;
+
+    [[nodiscard]] bool is_open() const noexcept;
+    [[nodiscard]] gsl::span<const std::byte> data() const noexcept;
+
+private:
+    void close() noexcept;
+
+    const std::byte *m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_open = false;
+};
+
+} // namespace linkollector
@@ -0,0 +1,214 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace linkollector {
+
+[[nodiscard]] static std::size_t bucket_for(std::uint64_t value) noexcept {
+    if (value < histogram::sub_buckets) {
+        return value;
+    }
+
+    std::size_t exponent = 0;
+    for (auto v = value; v >= histogram::sub_buckets; v >>= 1U) {
+        ++exponent;
+    }
+
+    // value lies in [sub_buckets << (exponent - 1) .. sub_buckets << exponent)
+    const std::size_t sub_bucket =
+        (value >> (exponent - 1)) & (histogram::sub_buckets - 1);
+    return exponent * histogram::sub_buckets + sub_bucket;
+}
+
+void histogram::record(std::uint64_t value) noexcept {
+    worker_metrics::add(this->m_counts.at(bucket_for(value)), 1);
+    worker_metrics::add(this->m_sum, value);
+}
+
+void histogram::merge(const histogram &other) noexcept {
+    for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        worker_metrics::add(this->m_counts.at(bucket), other.count_at(bucket));
+    }
+    worker_metrics::add(this->m_sum, other.sum());
+}
+
+std::uint64_t histogram::sum() const noexcept {
+    return this->m_sum.load(std::memory_order_relaxed);
+}
+
+std::uint64_t histogram::count_at(std::size_t bucket) const noexcept {
+    return this->m_counts.at(bucket).load(std::memory_order_relaxed);
+}
+
+std::uint64_t histogram::count() const noexcept {
+    std::uint64_t total = 0;
+    for (const auto &count_ : this->m_counts) {
+        total += count_.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::uint64_t histogram::value_at_quantile(double quantile) const noexcept {
+    const auto total = this->count();
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the value, counting from 1
+    const auto rank = std::max<std::uint64_t>(
+        1,
+        static_cast<std::uint64_t>(
+            std::ceil(quantile * static_cast<double>(total))));
+
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        seen += this->count_at(bucket);
+        if (seen >= rank) {
+            return upper_bound(bucket);
+        }
+    }
+    return upper_bound(bucket_count - 1);
+}
+
+std::uint64_t histogram::upper_bound(std::size_t bucket) noexcept {
+    if (bucket < sub_buckets) {
+        return bucket;
+    }
+
+    const auto exponent = bucket / sub_buckets;
+    const auto sub_bucket = bucket % sub_buckets;
+    // Wraps to the maximum for the topmost bucket
+    return ((std::uint64_t{sub_buckets} + sub_bucket + 1) << (exponent - 1)) -
+           1;
+}
+
+void worker_metrics::add(std::atomic<std::uint64_t> &counter,
+                         std::uint64_t value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+}
+
+metrics::metrics(unsigned int worker_count) {
+    this->m_workers.reserve(worker_count);
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        this->m_workers.push_back(std::make_unique<worker_metrics>());
+    }
+}
+
+worker_metrics &metrics::for_worker(unsigned int index) noexcept {
+    return *this->m_workers.at(index);
+}
+
+static void write_counter(std::ostringstream &out,
+                          const char *name,
+                          const char *help,
+                          std::uint64_t value) {
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " counter\n"
+        << name << " " << value << "\n";
+}
+
+static void write_histogram(std::ostringstream &out,
+                            const char *name,
+                            const char *help,
+                            const std::vector<const histogram *> &parts,
+                            double scale) {
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " histogram\n";
+
+    std::uint64_t cumulative = 0;
+    std::uint64_t sum = 0;
+
+    for (std::size_t bucket = 0; bucket < histogram::bucket_count; ++bucket) {
+        std::uint64_t count = 0;
+        for (const auto *part : parts) {
+            count += part->count_at(bucket);
+        }
+
+        // Empty buckets are left out, the le series stays cumulative
+        if (count == 0) {
+            continue;
+        }
+
+        cumulative += count;
+        const auto upper = static_cast<double>(histogram::upper_bound(bucket));
+        out << name << "_bucket{le=\"" << upper * scale << "\"} "
+            << cumulative << "\n";
+    }
+
+    for (const auto *part : parts) {
+        sum += part->sum();
+    }
+
+    out << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+        << name << "_sum " << static_cast<double>(sum) * scale << "\n"
+        << name << "_count " << cumulative << "\n";
+}
+
+std::string metrics::to_prometheus() const {
+    std::uint64_t messages = 0;
+    std::uint64_t parse_failures = 0;
+    std::uint64_t duplicates = 0;
+    std::uint64_t invalid_urls = 0;
+    std::uint64_t output_stalls = 0;
+    std::uint64_t output_drops = 0;
+    std::vector<const histogram *> payload_sizes;
+    std::vector<const histogram *> service_times;
+
+    for (const auto &worker : this->m_workers) {
+        messages += worker->messages.load(std::memory_order_relaxed);
+        parse_failures +=
+            worker->parse_failures.load(std::memory_order_relaxed);
+        duplicates += worker->duplicates.load(std::memory_order_relaxed);
+        invalid_urls += worker->invalid_urls.load(std::memory_order_relaxed);
+        output_stalls += worker->output_stalls.load(std::memory_order_relaxed);
+        output_drops += worker->output_drops.load(std::memory_order_relaxed);
+        payload_sizes.push_back(&worker->payload_size);
+        service_times.push_back(&worker->service_time_ns);
+    }
+
+    std::ostringstream out;
+    out.precision(12);
+
+    write_counter(out,
+                  "linkollector_messages_total",
+                  "Requests received by the responder.",
+                  messages);
+    write_counter(out,
+                  "linkollector_parse_failures_total",
+                  "Requests that could not be parsed.",
+                  parse_failures);
+    write_counter(out,
+                  "linkollector_duplicates_total",
+                  "Items suppressed as duplicates.",
+                  duplicates);
+    write_counter(out,
+                  "linkollector_invalid_urls_total",
+                  "URLs rejected as malformed.",
+                  invalid_urls);
+    write_counter(out,
+                  "linkollector_output_stalls_total",
+                  "Items that waited for room in the output queue.",
+                  output_stalls);
+    write_counter(out,
+                  "linkollector_output_drops_total",
+                  "Items discarded because the output queue was full or "
+                  "the output failed.",
+                  output_drops);
+    write_histogram(out,
+                    "linkollector_payload_size_bytes",
+                    "Payload size of accepted items.",
+                    payload_sizes,
+                    1.0);
+    write_histogram(out,
+                    "linkollector_service_time_seconds",
+                    "Time from receiving a request to finishing its output.",
+                    service_times,
+                    1e-9);
+
+    return out.str();
+}
+
+} // namespace linkollector
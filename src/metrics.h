@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace linkollector {
+
+// Log-linear histogram in the style of HdrHistogram: every power of two is
+// split into sub_buckets linear buckets, bounding the relative error to
+// 1 / sub_buckets over the whole 64-bit range. Recording is a relaxed
+// store by a single writer thread; any thread may read.
+class histogram final {
+
+public:
+    static constexpr std::size_t sub_bucket_bits = 3;
+    static constexpr std::size_t sub_buckets = 1U << sub_bucket_bits;
+    static constexpr std::size_t bucket_count =
+        (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    void record(std::uint64_t value) noexcept;
+
+    // Adds the values recorded by other, which must not be recording
+    void merge(const histogram &other) noexcept;
+
+    [[nodiscard]] std::uint64_t count_at(std::size_t bucket) const noexcept;
+    [[nodiscard]] std::uint64_t count() const noexcept;
+    [[nodiscard]] std::uint64_t sum() const noexcept;
+
+    // Upper bound of the bucket holding the value at quantile, from 0 to 1
+    [[nodiscard]] std::uint64_t
+    value_at_quantile(double quantile) const noexcept;
+
+    // Largest value falling into bucket
+    [[nodiscard]] static std::uint64_t
+    upper_bound(std::size_t bucket) noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> m_counts = {};
+    std::atomic<std::uint64_t> m_sum = 0;
+};
+
+// Counters and histograms owned by one worker thread, padded so workers
+// never share a cache line.
+struct alignas(64) worker_metrics final {
+    std::atomic<std::uint64_t> messages = 0;
+    std::atomic<std::uint64_t> parse_failures = 0;
+    std::atomic<std::uint64_t> duplicates = 0;
+    std::atomic<std::uint64_t> invalid_urls = 0;
+    std::atomic<std::uint64_t> output_stalls = 0;
+    std::atomic<std::uint64_t> output_drops = 0;
+    histogram payload_size;
+    histogram service_time_ns;
+
+    // Single-writer increment: cheaper than an atomic read-modify-write
+    static void add(std::atomic<std::uint64_t> &counter,
+                    std::uint64_t value) noexcept;
+};
+
+class metrics final {
+
+public:
+    explicit metrics(unsigned int worker_count);
+    metrics(const metrics &other) = delete;
+    metrics &operator=(const metrics &other) = delete;
+    metrics(metrics &&other) noexcept = default;
+    metrics &operator=(metrics &&other) noexcept = default;
+    ~metrics() noexcept = default;
+
+    [[nodiscard]] worker_metrics &for_worker(unsigned int index) noexcept;
+
+    // Sums all workers into a Prometheus text exposition.
+    [[nodiscard]] std::string to_prometheus() const;
+
+private:
+    std::vector<std::unique_ptr<worker_metrics>> m_workers;
+};
+
+} // namespace linkollector
@@ -0,0 +1,432 @@
+#include "outbox.h"
+
+#include "hash.h"
+#include "protocol.h"
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace linkollector {
+
+constexpr std::uint64_t magic = 0x584f4254554f4b4cULL; // "LKOUTBOX"
+constexpr std::size_t magic_offset = 0;
+constexpr std::size_t head_offset = sizeof(std::uint64_t);
+constexpr std::size_t tail_offset = 2 * sizeof(std::uint64_t);
+constexpr std::size_t generation_offset = 3 * sizeof(std::uint64_t);
+constexpr std::uint64_t header_size = 64;
+constexpr std::uint64_t initial_size = 64U * 1024U;
+
+constexpr std::size_t size_field_size = sizeof(std::uint32_t);
+constexpr std::size_t checksum_field_size = sizeof(std::uint32_t);
+constexpr std::size_t record_header_size =
+    size_field_size + checksum_field_size;
+constexpr std::size_t payload_offset = 1;
+
+constexpr unsigned int append_lock = 0;
+constexpr unsigned int claim_lock = 1;
+
+template <typename Integer>
+static void write_le(std::byte *destination, Integer value) noexcept {
+    for (std::size_t i = 0; i < sizeof(Integer); ++i) {
+        *std::next(destination, static_cast<std::ptrdiff_t>(i)) =
+            static_cast<std::byte>(value & 0xffU);
+        value = static_cast<Integer>(value >> 8U);
+    }
+}
+
+template <typename Integer>
+[[nodiscard]] static Integer read_le(const std::byte *source) noexcept {
+    Integer value = 0;
+    for (std::size_t i = sizeof(Integer); i > 0; --i) {
+        value = static_cast<Integer>(
+            (value << 8U) |
+            std::to_integer<Integer>(
+                *std::next(source, static_cast<std::ptrdiff_t>(i - 1))));
+    }
+    return value;
+}
+
+outbox::outbox(std::string path) noexcept : m_path(std::move(path)) {}
+
+#ifdef _WIN32
+
+outbox::~outbox() noexcept = default;
+
+bool outbox::open() noexcept {
+    std::cerr << "The outbox is not supported on this platform\n";
+    return false;
+}
+
+bool outbox::append(activity, std::string_view) noexcept { return false; }
+bool outbox::try_claim() noexcept { return false; }
+void outbox::release_claim() noexcept {}
+std::uint64_t outbox::head() noexcept { return 0; }
+std::uint64_t outbox::tail() noexcept { return 0; }
+std::uint64_t outbox::pending_count() noexcept { return 0; }
+std::optional<outbox::item> outbox::read(std::uint64_t) noexcept {
+    return std::nullopt;
+}
+bool outbox::remove_until(std::uint64_t) noexcept { return false; }
+
+#else
+
+outbox::~outbox() noexcept {
+    if (this->m_data != nullptr) {
+        ::munmap(this->m_data, this->m_size);
+    }
+    if (this->m_fd != -1) {
+        ::close(this->m_fd);
+    }
+}
+
+bool outbox::open() noexcept {
+    this->m_fd =
+        ::open(this->m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->m_fd == -1 || !this->lock(append_lock, true)) {
+        return false;
+    }
+
+    struct stat file_stat = {};
+    bool opened = ::fstat(this->m_fd, &file_stat) == 0;
+
+    if (opened &&
+        static_cast<std::uint64_t>(file_stat.st_size) < header_size) {
+        // New, or created by a process that died before writing the header
+        opened = this->resize(initial_size) && this->remap();
+        if (opened) {
+            this->set_header_field(magic_offset, magic);
+            this->set_header_field(head_offset, header_size);
+            this->set_header_field(tail_offset, header_size);
+            opened = this->sync(0, header_size);
+        }
+    } else if (opened) {
+        this->m_size = static_cast<std::uint64_t>(file_stat.st_size);
+        opened = this->remap();
+
+        const auto head_ = opened ? this->header_field(head_offset) : 0;
+        auto tail_ = opened ? this->header_field(tail_offset) : 0;
+
+        if (opened && (this->header_field(magic_offset) != magic ||
+                       head_ < header_size || head_ > tail_ ||
+                       tail_ > this->m_size)) {
+            std::cerr << this->m_path << " is not a valid outbox\n";
+            opened = false;
+        }
+
+        // Items written by a process that died before recording them
+        std::optional<std::uint64_t> maybe_end;
+        while (opened && (maybe_end = this->record_end(tail_)).has_value()) {
+            tail_ = *maybe_end;
+        }
+        if (opened && tail_ != this->header_field(tail_offset)) {
+            this->set_header_field(tail_offset, tail_);
+            opened = this->sync(0, header_size);
+        }
+    }
+
+    this->unlock(append_lock);
+    return opened;
+}
+
+bool outbox::append(activity activity_, std::string_view payload) noexcept {
+    const auto body_size = payload_offset + payload.size();
+    if (body_size > std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+    const auto record_size = record_header_size + body_size;
+
+    if (!this->lock(append_lock, true)) {
+        return false;
+    }
+
+    bool appended = this->refresh();
+    const auto tail_ = appended ? this->header_field(tail_offset) : 0;
+
+    if (appended && tail_ + record_size > this->m_size) {
+        auto size = std::max<std::uint64_t>(this->m_size, initial_size);
+        while (tail_ + record_size > size) {
+            size *= 2;
+        }
+        appended = this->resize(size) && this->remap();
+    }
+
+    if (appended) {
+        auto *const record =
+            std::next(this->m_data, static_cast<std::ptrdiff_t>(tail_));
+        auto *const body = std::next(
+            record, static_cast<std::ptrdiff_t>(record_header_size));
+
+        *body =
+            static_cast<std::byte>(protocol::v2::to_activity_code(activity_));
+        std::memcpy(std::next(body, payload_offset),
+                    payload.data(),
+                    payload.size());
+
+        write_le(record, static_cast<std::uint32_t>(body_size));
+        write_le(std::next(record, size_field_size),
+                 this->record_checksum({body, body_size}));
+
+        // The record must be on disk before the header points past it
+        appended = this->sync(tail_, tail_ + record_size);
+        if (appended) {
+            this->set_header_field(tail_offset, tail_ + record_size);
+            appended = this->sync(0, header_size);
+        }
+    }
+
+    this->unlock(append_lock);
+    return appended;
+}
+
+bool outbox::try_claim() noexcept {
+    this->m_claimed = this->lock(claim_lock, false);
+    return this->m_claimed;
+}
+
+void outbox::release_claim() noexcept {
+    if (this->m_claimed) {
+        this->unlock(claim_lock);
+        this->m_claimed = false;
+    }
+}
+
+std::uint64_t outbox::head() noexcept {
+    if (!this->lock(append_lock, true)) {
+        return 0;
+    }
+    const auto head_ =
+        this->refresh() ? this->header_field(head_offset) : header_size;
+    this->unlock(append_lock);
+    return head_;
+}
+
+std::uint64_t outbox::tail() noexcept {
+    if (!this->lock(append_lock, true)) {
+        return 0;
+    }
+    const auto tail_ =
+        this->refresh() ? this->header_field(tail_offset) : header_size;
+    this->unlock(append_lock);
+    return tail_;
+}
+
+std::uint64_t outbox::pending_count() noexcept {
+    if (!this->lock(append_lock, true)) {
+        return 0;
+    }
+
+    std::uint64_t count = 0;
+    if (this->refresh()) {
+        auto offset = this->header_field(head_offset);
+        const auto tail_ = this->header_field(tail_offset);
+        std::optional<std::uint64_t> maybe_end;
+        while (offset < tail_ &&
+               (maybe_end = this->record_end(offset)).has_value()) {
+            offset = *maybe_end;
+            ++count;
+        }
+    }
+
+    this->unlock(append_lock);
+    return count;
+}
+
+std::optional<outbox::item> outbox::read(std::uint64_t offset) noexcept {
+    const auto maybe_end = this->record_end(offset);
+    if (!maybe_end.has_value()) {
+        return std::nullopt;
+    }
+
+    const auto *const body =
+        std::next(this->m_data,
+                  static_cast<std::ptrdiff_t>(offset + record_header_size));
+    const auto *const payload_data = static_cast<const char *>(
+        static_cast<const void *>(std::next(body, payload_offset)));
+    const auto payload_size =
+        *maybe_end - offset - record_header_size - payload_offset;
+
+    return {{offset,
+             *maybe_end,
+             *protocol::v2::from_activity_code(*body),
+             std::string(payload_data, payload_size)}};
+}
+
+bool outbox::remove_until(std::uint64_t offset) noexcept {
+    if (!this->lock(append_lock, true)) {
+        return false;
+    }
+
+    bool removed = this->refresh();
+
+    if (removed && offset == this->header_field(tail_offset)) {
+        // Empty: start over at the front and give the space back. The
+        // delivered records stay in the file, so a new generation and a
+        // cleared first record keep open() from recovering them.
+        this->set_header_field(head_offset, header_size);
+        this->set_header_field(tail_offset, header_size);
+        this->set_header_field(generation_offset,
+                               this->header_field(generation_offset) + 1);
+        std::memset(
+            std::next(this->m_data, static_cast<std::ptrdiff_t>(header_size)),
+            0,
+            record_header_size);
+        removed = this->sync(0, header_size + record_header_size) &&
+                  this->resize(initial_size) && this->remap();
+    } else if (removed) {
+        this->set_header_field(head_offset, offset);
+        removed = this->sync(0, header_size);
+    }
+
+    this->unlock(append_lock);
+    return removed;
+}
+
+bool outbox::lock(unsigned int byte, bool wait) noexcept {
+    struct flock file_lock = {};
+    file_lock.l_type = F_WRLCK;
+    file_lock.l_whence = SEEK_SET;
+    file_lock.l_start = static_cast<off_t>(byte);
+    file_lock.l_len = 1;
+
+    while (::fcntl(this->m_fd, wait ? F_SETLKW : F_SETLK, &file_lock) == -1) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void outbox::unlock(unsigned int byte) noexcept {
+    struct flock file_lock = {};
+    file_lock.l_type = F_UNLCK;
+    file_lock.l_whence = SEEK_SET;
+    file_lock.l_start = static_cast<off_t>(byte);
+    file_lock.l_len = 1;
+    ::fcntl(this->m_fd, F_SETLK, &file_lock);
+}
+
+bool outbox::refresh() noexcept {
+    struct stat file_stat = {};
+    if (::fstat(this->m_fd, &file_stat) == -1) {
+        return false;
+    }
+
+    const auto size = static_cast<std::uint64_t>(file_stat.st_size);
+    if (size == this->m_size && this->m_data != nullptr) {
+        return true;
+    }
+
+    this->m_size = size;
+    return this->remap();
+}
+
+bool outbox::remap() noexcept {
+    if (this->m_data != nullptr) {
+        ::munmap(this->m_data, this->m_size);
+        this->m_data = nullptr;
+    }
+
+    void *mapping = ::mmap(nullptr,
+                           this->m_size,
+                           PROT_READ | PROT_WRITE,
+                           MAP_SHARED,
+                           this->m_fd,
+                           0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    this->m_data = static_cast<std::byte *>(mapping);
+    return true;
+}
+
+bool outbox::resize(std::uint64_t size) noexcept {
+    // The old mapping covers the old size, drop it before shrinking
+    if (this->m_data != nullptr) {
+        ::munmap(this->m_data, this->m_size);
+        this->m_data = nullptr;
+    }
+
+    if (::ftruncate(this->m_fd, static_cast<off_t>(size)) == -1) {
+        return false;
+    }
+    this->m_size = size;
+    return true;
+}
+
+std::uint64_t outbox::header_field(std::size_t offset) const noexcept {
+    return read_le<std::uint64_t>(
+        std::next(this->m_data, static_cast<std::ptrdiff_t>(offset)));
+}
+
+void outbox::set_header_field(std::size_t offset,
+                              std::uint64_t value) noexcept {
+    write_le(std::next(this->m_data, static_cast<std::ptrdiff_t>(offset)),
+             value);
+}
+
+bool outbox::sync(std::uint64_t begin, std::uint64_t end) noexcept {
+    const auto page_size = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    const auto page_begin = begin - begin % page_size;
+    return ::msync(std::next(this->m_data,
+                             static_cast<std::ptrdiff_t>(page_begin)),
+                   end - page_begin,
+                   MS_SYNC) == 0;
+}
+
+std::optional<std::uint64_t>
+outbox::record_end(std::uint64_t offset) const noexcept {
+    if (offset < header_size || this->m_size - offset < record_header_size) {
+        return std::nullopt;
+    }
+
+    const auto *const record =
+        std::next(this->m_data, static_cast<std::ptrdiff_t>(offset));
+    const auto body_size = read_le<std::uint32_t>(record);
+    const auto checksum =
+        read_le<std::uint32_t>(std::next(record, size_field_size));
+
+    if (body_size <= payload_offset ||
+        body_size > this->m_size - offset - record_header_size) {
+        return std::nullopt;
+    }
+
+    const gsl::span<const std::byte> body(
+        std::next(record, static_cast<std::ptrdiff_t>(record_header_size)),
+        body_size);
+
+    if (this->record_checksum(body) != checksum ||
+        !protocol::v2::from_activity_code(body[0]).has_value()) {
+        return std::nullopt;
+    }
+
+    return offset + record_header_size + body_size;
+}
+
+// Spools written before generations existed read as generation 0, whose
+// seed leaves their checksums unchanged
+std::uint32_t
+outbox::record_checksum(gsl::span<const std::byte> body) const noexcept {
+    const auto generation = this->header_field(generation_offset);
+    const auto seed =
+        static_cast<std::uint32_t>(generation ^ (generation >> 32U));
+    return crc32_update(seed, body);
+}
+
+#endif
+
+} // namespace linkollector
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "activity.h"
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace linkollector {
+
+// Durable spool of items waiting to be delivered to one server, kept in a
+// memory-mapped file so a sender can hand over an item and exit even when
+// the server is unreachable. The file holds
+//
+//   header: u64 magic, u64 head offset, u64 tail offset, u64 generation
+//   records: u32 body size, u32 CRC-32 of the body seeded with the
+//            generation, body: u8 activity code, payload
+//
+// with integers little-endian. Items between head and tail are pending;
+// delivered items are removed by moving the head past them, and the file
+// shrinks back to its initial size once it is empty. Emptying it also
+// starts a new generation, so delivered records left behind in the file
+// no longer pass their checksum and are never recovered again.
+//
+// An item is removed as soon as the server acknowledges it, so delivery
+// is only as durable as the server makes it. A responder with a link store
+// acknowledges once the item is appended, and with --sync-acks once it is
+// synced; otherwise a responder crash loses items acknowledged within the
+// last fsync interval, and without a store any item it has not written
+// out yet.
+//
+// Several processes may share a spool: appends and head moves are
+// serialized with a lock on the file, and one process at a time may claim
+// the right to deliver. Only supported on POSIX systems.
+class outbox final {
+
+public:
+    struct item final {
+        std::uint64_t offset;
+        // Offset of the next item
+        std::uint64_t end;
+        activity item_activity;
+        std::string payload;
+    };
+
+    explicit outbox(std::string path) noexcept;
+    outbox(const outbox &other) = delete;
+    outbox &operator=(const outbox &other) = delete;
+    outbox(outbox &&other) noexcept = delete;
+    outbox &operator=(outbox &&other) noexcept = delete;
+    ~outbox() noexcept;
+
+    // Creates the file if needed and recovers items appended by a process
+    // that died before recording them in the header.
+    [[nodiscard]] bool open() noexcept;
+
+    // Returns once the item is on disk.
+    [[nodiscard]] bool append(activity activity_,
+                              std::string_view payload) noexcept;
+
+    // Claims the right to deliver and remove items. Returns false if
+    // another process holds it.
+    [[nodiscard]] bool try_claim() noexcept;
+    void release_claim() noexcept;
+
+    // Offsets of the first pending item and of the end of the last one.
+    [[nodiscard]] std::uint64_t head() noexcept;
+    [[nodiscard]] std::uint64_t tail() noexcept;
+
+    // Number of items between head and tail.
+    [[nodiscard]] std::uint64_t pending_count() noexcept;
+
+    // Reads the item at offset, which must be below a tail returned
+    // earlier. Claim holder only.
+    [[nodiscard]] std::optional<item> read(std::uint64_t offset) noexcept;
+
+    // Removes every item before offset. Claim holder only.
+    [[nodiscard]] bool remove_until(std::uint64_t offset) noexcept;
+
+private:
+    // Locks one byte of the file: append_lock or claim_lock
+    [[nodiscard]] bool lock(unsigned int byte, bool wait) noexcept;
+    void unlock(unsigned int byte) noexcept;
+    // Maps the file again if another process resized it. Append lock
+    // holder only.
+    [[nodiscard]] bool refresh() noexcept;
+    [[nodiscard]] bool remap() noexcept;
+    [[nodiscard]] bool resize(std::uint64_t size) noexcept;
+    [[nodiscard]] std::uint64_t
+    header_field(std::size_t offset) const noexcept;
+    void set_header_field(std::size_t offset, std::uint64_t value) noexcept;
+    [[nodiscard]] bool sync(std::uint64_t begin, std::uint64_t end) noexcept;
+    [[nodiscard]] std::optional<std::uint64_t>
+    record_end(std::uint64_t offset) const noexcept;
+    [[nodiscard]] std::uint32_t
+    record_checksum(gsl::span<const std::byte> body) const noexcept;
+
+    std::string m_path;
+    int m_fd = -1;
+    std::byte *m_data = nullptr;
+    std::uint64_t m_size = 0;
+    bool m_claimed = false;
+};
+
+} // namespace linkollector
@@ -0,0 +1,242 @@
+#include "protocol.h"
+
+#include "macros.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace linkollector::protocol {
+
+std::string serialize(activity activity_, std::string_view message) {
+    std::string data;
+    data += activity_to_string(activity_);
+    data += activity_delimiter;
+    data += message;
+    return data;
+}
+
+std::optional<std::pair<activity, std::string_view>>
+deserialize(gsl::span<const std::byte> msg) noexcept {
+    // The activity name precedes the first delimiter, and no name is longer
+    // than max_activity_length, so a delimiter found any later could not
+    // yield a valid message: only the prefix has to be searched, no matter
+    // how large the payload is.
+    const auto prefix = msg.first(
+        std::min(msg.size(), max_activity_length + activity_delimiter.size()));
+
+    const auto *const prefix_begin = prefix.data();
+    const auto *const prefix_end =
+        std::next(prefix_begin, static_cast<std::ptrdiff_t>(prefix.size()));
+
+    const auto *const delimiter_begin =
+        std::search(prefix_begin,
+                    prefix_end,
+                    std::begin(activity_delimiter_bin),
+                    std::end(activity_delimiter_bin));
+
+    if (delimiter_begin == prefix_begin || delimiter_begin == prefix_end) {
+        return std::nullopt;
+    }
+
+    const auto activity_size =
+        static_cast<std::size_t>(std::distance(prefix_begin, delimiter_begin));
+    const auto payload_offset = activity_size + activity_delimiter.size();
+
+    if (payload_offset == msg.size()) {
+        return std::nullopt;
+    }
+
+    const auto maybe_activity = activity_from_string(
+        {static_cast<const char *>(static_cast<const void *>(prefix_begin)),
+         activity_size});
+
+    if (!maybe_activity.has_value()) {
+        return std::nullopt;
+    }
+
+    const auto payload = msg.subspan(payload_offset);
+    const auto *const payload_data =
+        static_cast<const char *>(static_cast<const void *>(payload.data()));
+
+    return {std::make_pair(*maybe_activity,
+                           std::string_view(payload_data, payload.size()))};
+}
+
+namespace v2 {
+
+constexpr std::size_t version_offset = 0;
+constexpr std::size_t activity_offset = 1;
+constexpr std::size_t flags_offset = 2;
+constexpr std::size_t reserved_offset = 3;
+constexpr std::size_t payload_size_offset = 4;
+
+constexpr std::uint8_t known_flags = chunk_flag | trace_flag;
+
+template <typename Integer, typename Bytes>
+static void write_le(Bytes &destination,
+                     std::size_t offset,
+                     Integer value) noexcept {
+    for (std::size_t i = 0; i < sizeof(Integer); ++i) {
+        destination.at(offset + i) = static_cast<std::byte>(value & 0xffU);
+        value = static_cast<Integer>(value >> 8U);
+    }
+}
+
+template <typename Integer>
+[[nodiscard]] static Integer read_le(gsl::span<const std::byte> source,
+                                     std::size_t offset) noexcept {
+    Integer value = 0;
+    for (std::size_t i = sizeof(Integer); i > 0; --i) {
+        value = static_cast<Integer>(
+            (value << 8U) | std::to_integer<Integer>(source[offset + i - 1]));
+    }
+    return value;
+}
+
+activity_code to_activity_code(activity activity_) noexcept {
+    switch (activity_) {
+    case activity::url: {
+        return activity_code::url;
+    }
+    case activity::text: {
+        return activity_code::text;
+    }
+    }
+    LINKOLLECTOR_UNREACHABLE;
+}
+
+std::optional<activity> from_activity_code(std::byte code) noexcept {
+    switch (static_cast<activity_code>(code)) {
+    case activity_code::url: {
+        return activity::url;
+    }
+    case activity_code::text: {
+        return activity::text;
+    }
+    }
+    return std::nullopt;
+}
+
+header_t serialize_header(activity activity_,
+                          std::size_t payload_size,
+                          std::uint8_t flags) noexcept {
+    header_t header = {};
+    header.at(version_offset) = static_cast<std::byte>(version);
+    header.at(activity_offset) =
+        static_cast<std::byte>(to_activity_code(activity_));
+    header.at(flags_offset) = static_cast<std::byte>(flags);
+    header.at(reserved_offset) = std::byte{0};
+    write_le<std::uint64_t>(header, payload_size_offset, payload_size);
+    return header;
+}
+
+chunk_descriptor_t serialize_chunk_descriptor(const chunk &chunk_) noexcept {
+    chunk_descriptor_t descriptor = {};
+    write_le(descriptor, 0, chunk_.stream_id);
+    write_le(descriptor, sizeof(std::uint64_t), chunk_.offset);
+    write_le(descriptor, 2 * sizeof(std::uint64_t), chunk_.total_size);
+    return descriptor;
+}
+
+trace_context_t
+serialize_trace_context(const trace_context &context) noexcept {
+    trace_context_t serialized = {};
+    write_le(serialized, 0, context.trace_id);
+    write_le(serialized, sizeof(std::uint64_t), context.sent_at_ns);
+    return serialized;
+}
+
+[[nodiscard]] static bool
+is_traced(gsl::span<const std::byte> header) noexcept {
+    return (std::to_integer<std::uint8_t>(header[flags_offset]) &
+            trace_flag) != 0;
+}
+
+std::optional<std::pair<activity, std::string_view>>
+deserialize(gsl::span<const std::byte> header,
+            gsl::span<const std::byte> payload) noexcept {
+    if (header.size() != header_size ||
+        std::to_integer<std::uint8_t>(header[version_offset]) != version) {
+        return std::nullopt;
+    }
+
+    const auto flags = std::to_integer<std::uint8_t>(header[flags_offset]);
+    if ((flags & static_cast<std::uint8_t>(~known_flags)) != 0) {
+        return std::nullopt;
+    }
+
+    const auto size = read_le<std::uint64_t>(header, payload_size_offset);
+
+    const auto prefix_size = is_traced(header) ? trace_context_size : 0;
+
+    if (size != payload.size() || payload.size() <= prefix_size) {
+        return std::nullopt;
+    }
+
+    const auto maybe_activity = from_activity_code(header[activity_offset]);
+
+    if (!maybe_activity.has_value()) {
+        return std::nullopt;
+    }
+
+    const auto item = payload.subspan(prefix_size);
+    const auto *const item_data =
+        static_cast<const char *>(static_cast<const void *>(item.data()));
+
+    return {std::make_pair(*maybe_activity,
+                           std::string_view(item_data, item.size()))};
+}
+
+std::optional<std::uint64_t>
+payload_size(gsl::span<const std::byte> header) noexcept {
+    if (header.size() != header_size ||
+        std::to_integer<std::uint8_t>(header[version_offset]) != version) {
+        return std::nullopt;
+    }
+
+    return {read_le<std::uint64_t>(header, payload_size_offset)};
+}
+
+bool is_chunk(gsl::span<const std::byte> header) noexcept {
+    return (std::to_integer<std::uint8_t>(header[flags_offset]) &
+            chunk_flag) != 0;
+}
+
+std::optional<trace_context>
+deserialize_trace_context(gsl::span<const std::byte> header,
+                          gsl::span<const std::byte> payload) noexcept {
+    if (!is_traced(header)) {
+        return std::nullopt;
+    }
+
+    return {{read_le<std::uint64_t>(payload, 0),
+             read_le<std::uint64_t>(payload, sizeof(std::uint64_t))}};
+}
+
+std::optional<std::pair<chunk, std::string_view>>
+deserialize_chunk(std::string_view payload) noexcept {
+    if (payload.size() <= chunk_descriptor_size) {
+        return std::nullopt;
+    }
+
+    const gsl::span<const std::byte> descriptor(
+        static_cast<const std::byte *>(
+            static_cast<const void *>(payload.data())),
+        chunk_descriptor_size);
+    const chunk chunk_{
+        read_le<std::uint64_t>(descriptor, 0),
+        read_le<std::uint64_t>(descriptor, sizeof(std::uint64_t)),
+        read_le<std::uint64_t>(descriptor, 2 * sizeof(std::uint64_t))};
+    const auto data = payload.substr(chunk_descriptor_size);
+
+    if (chunk_.offset > chunk_.total_size ||
+        data.size() > chunk_.total_size - chunk_.offset) {
+        return std::nullopt;
+    }
+
+    return {std::make_pair(chunk_, data)};
+}
+
+} // namespace v2
+
+} // namespace linkollector::protocol
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "activity.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <gsl/span>
+
+namespace linkollector::protocol {
+
+constexpr std::string_view activity_delimiter = "\uedfd";
+constexpr std::array<std::byte, activity_delimiter.size()>
+    activity_delimiter_bin = []() {
+        std::array<std::byte, activity_delimiter.size()> delim = {};
+        for (std::size_t i = 0; i < activity_delimiter.size(); ++i) {
+            delim.at(i) = static_cast<std::byte>(activity_delimiter[i]);
+        }
+        return delim;
+    }();
+
+[[nodiscard]] std::string serialize(activity activity_,
+                                    std::string_view message);
+
+// The returned payload borrows from msg.
+[[nodiscard]] std::optional<std::pair<activity, std::string_view>>
+deserialize(gsl::span<const std::byte> msg) noexcept;
+
+// Version 2 sends a message as two frames: a fixed-size header followed by
+// the raw payload, which is never scanned.
+//
+// Header layout, integers little-endian:
+//   0      version (2)
+//   1      activity code
+//   2      flags
+//   3      reserved (0)
+//   4..11  payload size in bytes
+//
+// With the chunk flag set, the payload is one piece of an item too large
+// to send at once. It starts with a chunk descriptor, integers
+// little-endian:
+//   0..7   stream id, chosen by the sender
+//   8..15  offset of the chunk data within the item
+//   16..23 total size of the item
+// followed by the chunk data. Chunks may arrive in any order.
+//
+// With the trace flag set, the payload starts with a trace context, before
+// any chunk descriptor, integers little-endian:
+//   0..7   trace id, chosen by the sender
+//   8..15  send time in nanoseconds since the Unix epoch
+namespace v2 {
+
+constexpr std::uint8_t version = 2;
+constexpr std::size_t header_size = 12;
+constexpr std::uint8_t chunk_flag = 0x01;
+constexpr std::uint8_t trace_flag = 0x02;
+constexpr std::size_t chunk_descriptor_size = 24;
+constexpr std::size_t trace_context_size = 16;
+
+using header_t = std::array<std::byte, header_size>;
+using chunk_descriptor_t = std::array<std::byte, chunk_descriptor_size>;
+using trace_context_t = std::array<std::byte, trace_context_size>;
+
+struct chunk final {
+    std::uint64_t stream_id;
+    std::uint64_t offset;
+    std::uint64_t total_size;
+};
+
+struct trace_context final {
+    std::uint64_t trace_id;
+    std::uint64_t sent_at_ns;
+};
+
+enum class activity_code : std::uint8_t {
+    url = 1,
+    text = 2,
+};
+
+[[nodiscard]] activity_code to_activity_code(activity activity_) noexcept;
+
+[[nodiscard]] std::optional<activity>
+from_activity_code(std::byte code) noexcept;
+
+// Replies to v2 requests carry a one-byte status frame; replies to v1
+// requests stay empty.
+enum class status : std::uint8_t {
+    ok = 0,
+    rejected = 1,
+};
+
+[[nodiscard]] header_t serialize_header(activity activity_,
+                                        std::size_t payload_size,
+                                        std::uint8_t flags = 0) noexcept;
+
+[[nodiscard]] chunk_descriptor_t
+serialize_chunk_descriptor(const chunk &chunk_) noexcept;
+
+[[nodiscard]] trace_context_t
+serialize_trace_context(const trace_context &context) noexcept;
+
+// The returned payload borrows from payload and leaves out any trace
+// context.
+[[nodiscard]] std::optional<std::pair<activity, std::string_view>>
+deserialize(gsl::span<const std::byte> header,
+            gsl::span<const std::byte> payload) noexcept;
+
+// The payload size a v2 header announces, before the payload has been
+// received.
+[[nodiscard]] std::optional<std::uint64_t>
+payload_size(gsl::span<const std::byte> header) noexcept;
+
+// Only meaningful for a header deserialize accepted.
+[[nodiscard]] bool is_chunk(gsl::span<const std::byte> header) noexcept;
+
+// The trace context of a request deserialize accepted, if it has one.
+[[nodiscard]] std::optional<trace_context>
+deserialize_trace_context(gsl::span<const std::byte> header,
+                          gsl::span<const std::byte> payload) noexcept;
+
+// Splits a chunk payload into its descriptor and data, checking that the
+// data lies within the item. The returned data borrows from payload.
+[[nodiscard]] std::optional<std::pair<chunk, std::string_view>>
+deserialize_chunk(std::string_view payload) noexcept;
+
+} // namespace v2
+
+} // namespace linkollector::protocol
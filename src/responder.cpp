@@ -0,0 +1,980 @@
+#include "responder.h"
+
+#include "activity.h"
+#include "buffer_pool.h"
+#include "dedup_cache.h"
+#include "link_analytics.h"
+#include "metrics.h"
+#include "protocol.h"
+#include "signal_helper.h"
+#include "sink.h"
+#include "store.h"
+#include "stream_writer.h"
+#include "tracer.h"
+#include "url.h"
+#include "wrappers/zmq/context.h"
+#include "wrappers/zmq/message.h"
+#include "wrappers/zmq/poller.h"
+#include "wrappers/zmq/socket.h"
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace linkollector::responder {
+
+constexpr const char *frontend_endpoint = "tcp://*:17729";
+constexpr const char *backend_endpoint = "inproc://workers";
+constexpr const char *publish_endpoint = "inproc://publish";
+
+// Output records up to this size are built in a worker's buffer pool
+constexpr std::size_t record_buffer_size = 2048;
+
+// v2 payloads up to this size are received into a worker's buffer instead
+// of a libzmq message
+constexpr std::size_t receive_buffer_size = 4096;
+
+// Scratch memory each worker resets after every request. Output records
+// are formatted in it, larger ones spill to the heap.
+constexpr std::size_t arena_size = 16U * 1024U;
+
+// Spans each worker can hold between two flushes of the trace
+constexpr std::size_t trace_capacity = 64U * 1024U;
+constexpr std::chrono::milliseconds trace_flush_interval(100);
+
+// How often shutdown checks whether the outputs are flushed
+constexpr std::chrono::milliseconds shutdown_poll_interval(10);
+
+// How often streams are checked for having gone idle
+constexpr std::chrono::milliseconds stream_expiry_interval(1000);
+
+static std::mutex s_error_mutex;
+
+// Receives the payload frame of a v2 request, into buffer if the header
+// announces a payload that fits and into payload_msg otherwise. Returns
+// nullopt if receiving failed. Requests with more frames than expected or
+// a payload larger than announced are drained and left with an empty
+// payload, which the v2 parser rejects.
+[[nodiscard]] static std::optional<gsl::span<std::byte>>
+receive_payload(wrappers::zmq::socket &worker_socket,
+                gsl::span<const std::byte> header,
+                gsl::span<std::byte> buffer,
+                wrappers::zmq::message &payload_msg) noexcept {
+    gsl::span<std::byte> payload;
+    bool more = false;
+
+    const auto maybe_size = protocol::v2::payload_size(header);
+    if (maybe_size.has_value() && *maybe_size <= buffer.size()) {
+        const auto maybe_received = worker_socket.blocking_receive(buffer);
+        if (!maybe_received.has_value()) {
+            return std::nullopt;
+        }
+        if (*maybe_received <= buffer.size()) {
+            payload = buffer.first(*maybe_received);
+        }
+        more = worker_socket.more();
+    } else {
+        if (!worker_socket.blocking_receive(payload_msg)) {
+            return std::nullopt;
+        }
+        payload = payload_msg.data();
+        more = payload_msg.more();
+    }
+
+    if (!more) {
+        return {payload};
+    }
+
+    while (more) {
+        if (!worker_socket.blocking_receive(payload_msg)) {
+            return std::nullopt;
+        }
+        more = payload_msg.more();
+    }
+
+    payload_msg = wrappers::zmq::message();
+    return {gsl::span<std::byte>()};
+}
+
+[[nodiscard]] static bool send_reply(wrappers::zmq::socket &worker_socket,
+                                     bool is_v2,
+                                     bool accepted) noexcept {
+    if (!is_v2) {
+        return worker_socket.blocking_send();
+    }
+
+    const auto status =
+        accepted ? protocol::v2::status::ok : protocol::v2::status::rejected;
+
+    wrappers::zmq::message reply(sizeof(status));
+    reply.data()[0] = static_cast<std::byte>(status);
+    return worker_socket.blocking_send(std::move(reply));
+}
+
+// Optional processing stages shared by all workers
+struct stages final {
+    dedup_cache *dedup = nullptr;
+    store *link_store = nullptr;
+    sink *output = nullptr;
+    stream_writer *streams = nullptr;
+    link_analytics *analytics = nullptr;
+    tracer *traces = nullptr;
+    bool canonicalize_urls = false;
+    bool sync_acks = false;
+    bool publish = false;
+};
+
+// Spans of the request a worker is handling, recorded only if the sender
+// traced it. Each mark closes the span the previous one opened.
+struct message_trace final {
+    tracer *traces = nullptr;
+    unsigned int worker = 0;
+    std::uint64_t trace_id = 0;
+    std::uint64_t last_ns = 0;
+
+    void mark(tracer::span kind) noexcept {
+        if (this->traces == nullptr) {
+            return;
+        }
+
+        const auto now = tracer::now();
+        tracer::event event_{kind, this->trace_id, this->last_ns, now};
+        this->traces->record(this->worker, event_);
+        this->last_ns = now;
+    }
+};
+
+// Owned by one worker thread
+struct worker_state final {
+    unsigned int index;
+    worker_metrics &metrics;
+    buffer_pool &records;
+    std::pmr::memory_resource &arena;
+    wrappers::zmq::socket *publisher;
+    message_trace trace;
+};
+
+// Publishes an item as two frames, the activity as topic and the payload.
+// A PUB socket drops messages for slow subscribers instead of blocking.
+static void publish(wrappers::zmq::socket &publisher,
+                    activity activity_,
+                    std::string_view payload) noexcept {
+    const auto topic = activity_to_string(activity_);
+    wrappers::zmq::message topic_msg(topic.size());
+    std::copy(std::begin(topic),
+              std::end(topic),
+              static_cast<char *>(
+                  static_cast<void *>(topic_msg.data().data())));
+
+    wrappers::zmq::message payload_msg(payload.size());
+    std::copy(std::begin(payload),
+              std::end(payload),
+              static_cast<char *>(
+                  static_cast<void *>(payload_msg.data().data())));
+
+    [[maybe_unused]] const bool published =
+        publisher.blocking_send_more(std::move(topic_msg)) &&
+        publisher.blocking_send(std::move(payload_msg));
+}
+
+// Appends an accepted item to the link store, if there is one, before it
+// is acknowledged. Returns false if the item could not be stored.
+[[nodiscard]] static bool persist(const stages &stages_,
+                                  activity activity_,
+                                  std::string_view payload) noexcept {
+    if (stages_.link_store == nullptr) {
+        return true;
+    }
+
+    const auto maybe_sequence =
+        stages_.link_store->append(activity_, payload);
+    return maybe_sequence.has_value() &&
+           (!stages_.sync_acks ||
+            stages_.link_store->wait_synced(*maybe_sequence));
+}
+
+// Hands a stored item to every other enabled stage.
+static void deliver(const stages &stages_,
+                    worker_state &state,
+                    activity activity_,
+                    std::string_view payload) noexcept {
+    if (stages_.analytics != nullptr && activity_ == activity::url) {
+        stages_.analytics->add(state.index, payload);
+    }
+
+    state.trace.mark(tracer::span::process);
+
+    switch (stages_.output->write(
+        activity_, payload, &state.records, &state.arena)) {
+    case sink::write_result::queued: {
+        break;
+    }
+    case sink::write_result::stalled: {
+        worker_metrics::add(state.metrics.output_stalls, 1);
+        break;
+    }
+    case sink::write_result::dropped: {
+        worker_metrics::add(state.metrics.output_drops, 1);
+        break;
+    }
+    }
+
+    state.trace.mark(tracer::span::sink_write);
+
+    if (state.publisher != nullptr) {
+        publish(*state.publisher, activity_, payload);
+        state.trace.mark(tracer::span::publish);
+    }
+}
+
+// Writes one chunk of a streamed item. A completed item is passed on as
+// the path of its file, prefixed with '@' like on the sender's command
+// line.
+[[nodiscard]] static bool write_chunk(const stages &stages_,
+                                      worker_state &state,
+                                      activity activity_,
+                                      std::string_view payload) noexcept {
+    if (stages_.streams == nullptr) {
+        return false;
+    }
+
+    const auto maybe_chunk = protocol::v2::deserialize_chunk(payload);
+    if (!maybe_chunk.has_value()) {
+        return false;
+    }
+
+    const auto [chunk_, data] = *maybe_chunk;
+    std::string path;
+
+    switch (stages_.streams->write(chunk_, data, path)) {
+    case stream_writer::result::failed: {
+        return false;
+    }
+    case stream_writer::result::accepted: {
+        return true;
+    }
+    case stream_writer::result::completed: {
+        break;
+    }
+    }
+
+    path.insert(0, 1, '@');
+    if (!persist(stages_, activity_, path)) {
+        return false;
+    }
+    deliver(stages_, state, activity_, path);
+    return true;
+}
+
+// Canonicalizes a URL where it was received, in the tail of its frame.
+// Returns the shortened URL, or nullopt if it is malformed.
+[[nodiscard]] static std::optional<std::string_view>
+canonicalize_url(gsl::span<std::byte> frame, std::string_view url_) noexcept {
+    auto *const url_data = static_cast<char *>(
+        static_cast<void *>(frame.last(url_.size()).data()));
+
+    const auto maybe_size = url::canonicalize({url_data, url_.size()});
+    if (!maybe_size.has_value()) {
+        return std::nullopt;
+    }
+
+    return std::string_view(url_data, *maybe_size);
+}
+
+static void record_service_time(
+    worker_metrics &metrics_,
+    std::chrono::steady_clock::time_point start) noexcept {
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    metrics_.service_time_ns.record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+            .count()));
+}
+
+// Starts recording the spans of a traced request with the ones that ended
+// before it was known to be traced.
+static void start_trace(message_trace &trace,
+                        tracer &traces,
+                        const protocol::v2::trace_context &context,
+                        std::uint64_t woken_ns,
+                        std::uint64_t received_ns) noexcept {
+    trace.traces = &traces;
+    trace.trace_id = context.trace_id;
+
+    tracer::event transit{
+        tracer::span::transit, context.trace_id, context.sent_at_ns, woken_ns};
+    traces.record(trace.worker, transit);
+
+    tracer::event receive{
+        tracer::span::receive, context.trace_id, woken_ns, received_ns};
+    traces.record(trace.worker, receive);
+
+    trace.last_ns = received_ns;
+}
+
+static void worker(wrappers::zmq::context &ctx,
+                   const stages &stages_,
+                   unsigned int index,
+                   worker_metrics &metrics_,
+                   buffer_pool &records) noexcept {
+    wrappers::zmq::socket worker_socket(ctx, wrappers::zmq::socket::type::rep);
+    if (!worker_socket.connect(backend_endpoint)) {
+        const std::lock_guard<std::mutex> lock(s_error_mutex);
+        std::cerr << "Failed to connect the worker socket\n";
+        return;
+    }
+
+    wrappers::zmq::poller poller;
+    if (!poller.add(worker_socket, wrappers::zmq::poll_event::in)) {
+        const std::lock_guard<std::mutex> lock(s_error_mutex);
+        std::cerr << "Failed to register the worker socket\n";
+        return;
+    }
+
+    std::optional<wrappers::zmq::socket> publisher;
+    if (stages_.publish) {
+        publisher.emplace(ctx, wrappers::zmq::socket::type::pub);
+        if (!publisher->connect(publish_endpoint)) {
+            const std::lock_guard<std::mutex> lock(s_error_mutex);
+            std::cerr << "Failed to connect the worker's publisher\n";
+            return;
+        }
+    }
+
+    // Only this thread receives into the pool, so a single buffer, given
+    // back at the end of every request, is enough
+    buffer_pool receive_buffers(receive_buffer_size, 1);
+
+    std::array<std::byte, arena_size> arena_buffer = {};
+    std::pmr::monotonic_buffer_resource arena(arena_buffer.data(),
+                                              arena_buffer.size());
+
+    worker_state state{index,
+                       metrics_,
+                       records,
+                       arena,
+                       publisher.has_value() ? &*publisher : nullptr,
+                       {}};
+    state.trace.worker = index;
+
+    // Taken only while tracing, in case the request turns out to be traced
+    std::uint64_t woken_ns = 0;
+    std::uint64_t received_ns = 0;
+
+    wrappers::zmq::message msg;
+    wrappers::zmq::message payload_msg;
+
+    while (true) {
+        const auto maybe_responses = poller.wait();
+
+        // Context shutdown surfaces as a failed poll (ETERM)
+        if (!maybe_responses.has_value()) {
+            break;
+        }
+
+        if (maybe_responses->empty()) {
+            continue;
+        }
+
+        if (stages_.traces != nullptr) {
+            woken_ns = tracer::now();
+        }
+        state.trace.traces = nullptr;
+
+        if (!worker_socket.blocking_receive(msg)) {
+            break;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        worker_metrics::add(metrics_.messages, 1);
+
+        // v1 requests are a single frame, v2 requests a header and payload
+        const bool is_v2 = msg.more();
+
+        auto receive_buffer = receive_buffers.acquire(receive_buffer_size);
+        gsl::span<std::byte> payload_frame;
+        if (is_v2) {
+            const auto maybe_payload = receive_payload(
+                worker_socket, msg.data(), receive_buffer.data(), payload_msg);
+            if (!maybe_payload.has_value()) {
+                break;
+            }
+            payload_frame = *maybe_payload;
+        }
+        arena.release();
+
+        if (stages_.traces != nullptr) {
+            received_ns = tracer::now();
+        }
+
+        const auto maybe_data =
+            is_v2 ? protocol::v2::deserialize(msg.data(), payload_frame)
+                  : protocol::deserialize(msg.data());
+
+        if (stages_.traces != nullptr && is_v2 && maybe_data.has_value()) {
+            const auto maybe_context =
+                protocol::v2::deserialize_trace_context(msg.data(),
+                                                        payload_frame);
+            if (maybe_context.has_value()) {
+                start_trace(state.trace,
+                            *stages_.traces,
+                            *maybe_context,
+                            woken_ns,
+                            received_ns);
+            }
+        }
+
+        // Chunks are acknowledged once written, which paces the sender
+        if (maybe_data.has_value() && is_v2 &&
+            protocol::v2::is_chunk(msg.data())) {
+            const bool written = write_chunk(
+                stages_, state, maybe_data->first, maybe_data->second);
+            if (!send_reply(worker_socket, is_v2, written)) {
+                break;
+            }
+            state.trace.mark(tracer::span::ack);
+            record_service_time(metrics_, start);
+            continue;
+        }
+
+        // Malformed URLs are rejected before any stage sees them
+        auto maybe_item = maybe_data;
+        bool invalid_url = false;
+        if (maybe_item.has_value() && stages_.canonicalize_urls &&
+            maybe_item->first == activity::url) {
+            const auto frame = is_v2 ? payload_frame : msg.data();
+            const auto maybe_url = canonicalize_url(frame, maybe_item->second);
+            if (maybe_url.has_value()) {
+                maybe_item->second = *maybe_url;
+            } else {
+                invalid_url = true;
+                maybe_item.reset();
+            }
+        }
+
+        state.trace.mark(tracer::span::deserialize);
+
+        // Items are stored before they are acknowledged, as a sender may
+        // forget an item once it is. Duplicates are acknowledged, but go
+        // no further.
+        bool duplicate = false;
+        bool accepted = false;
+        if (maybe_item.has_value()) {
+            const auto [activity_, payload] = *maybe_item;
+            duplicate = stages_.dedup != nullptr &&
+                        stages_.dedup->check_and_insert(activity_, payload);
+            accepted = duplicate || persist(stages_, activity_, payload);
+        }
+
+        if (!send_reply(worker_socket, is_v2, accepted)) {
+            break;
+        }
+
+        state.trace.mark(tracer::span::ack);
+
+        if (invalid_url) {
+            worker_metrics::add(metrics_.invalid_urls, 1);
+            record_service_time(metrics_, start);
+            continue;
+        }
+
+        if (!maybe_item.has_value()) {
+            worker_metrics::add(metrics_.parse_failures, 1);
+            {
+                const std::lock_guard<std::mutex> lock(s_error_mutex);
+                std::cerr << "Could not parse message from client\n";
+            }
+            record_service_time(metrics_, start);
+            continue;
+        }
+
+        if (duplicate) {
+            worker_metrics::add(metrics_.duplicates, 1);
+            record_service_time(metrics_, start);
+            continue;
+        }
+
+        // The store reported why it failed
+        if (!accepted) {
+            record_service_time(metrics_, start);
+            continue;
+        }
+
+        const auto [activity_, payload] = *maybe_item;
+
+        metrics_.payload_size.record(payload.size());
+        deliver(stages_, state, activity_, payload);
+        record_service_time(metrics_, start);
+    }
+}
+
+// Replaces path through a rename, so scrapers never see a partial file
+[[nodiscard]] static bool write_metrics_file(const std::string &path,
+                                             const metrics &metrics_) {
+    const auto temporary_path = path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        file << metrics_.to_prometheus();
+        if (!file.flush()) {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+}
+
+int run(wrappers::zmq::context &ctx,
+        signal_helper::sigint_guard &signals,
+        const options &options_) noexcept {
+    stages stages_;
+
+    std::optional<dedup_cache> dedup;
+    if (options_.dedup_window.has_value()) {
+        dedup.emplace(options_.dedup_memory, *options_.dedup_window);
+        stages_.dedup = &*dedup;
+    }
+
+    stages_.canonicalize_urls = options_.canonicalize_urls;
+    stages_.sync_acks = options_.store_sync_acks;
+
+    std::optional<store> link_store;
+    if (options_.store_directory.has_value()) {
+        link_store.emplace(*options_.store_directory,
+                           options_.store_segment_size,
+                           options_.store_fsync_interval);
+        if (!link_store->open()) {
+            std::cerr << "Failed to open the link store in "
+                      << *options_.store_directory << "\n";
+            return EXIT_FAILURE;
+        }
+        stages_.link_store = &*link_store;
+    }
+
+    // Records are handed back to their pool by the sink's writer thread,
+    // so the pools have to outlive the sink. Together they cover the whole
+    // queue and the batch being written; a worker that gets ahead of its
+    // share spills to the heap.
+    const auto records_in_flight =
+        2 * ring_capacity(options_.output_queue_capacity);
+    const auto records_per_worker =
+        (records_in_flight + options_.worker_count - 1) /
+        options_.worker_count;
+    std::vector<std::unique_ptr<buffer_pool>> record_pools;
+    record_pools.reserve(options_.worker_count);
+    for (unsigned int i = 0; i < options_.worker_count; ++i) {
+        record_pools.push_back(std::make_unique<buffer_pool>(
+            record_buffer_size, records_per_worker));
+    }
+
+    sink output(options_.output_format,
+                options_.output_queue_capacity,
+                options_.output_wait,
+                options_.output_overflow);
+    if (!output.open(options_.output_target, options_.output_path)) {
+        std::cerr << "Failed to open the output\n";
+        return EXIT_FAILURE;
+    }
+    stages_.output = &output;
+
+    std::optional<stream_writer> streams;
+    if (options_.stream_directory.has_value()) {
+        streams.emplace(*options_.stream_directory);
+        if (!streams->open()) {
+            std::cerr << "Failed to create the stream directory "
+                      << *options_.stream_directory << "\n";
+            return EXIT_FAILURE;
+        }
+        stages_.streams = &*streams;
+    }
+
+    wrappers::zmq::socket frontend_socket(ctx,
+                                          wrappers::zmq::socket::type::router);
+    if (!frontend_socket.bind(frontend_endpoint)) {
+        std::cerr << "Failed to bind the TCP responder socket\n";
+        return EXIT_FAILURE;
+    }
+    if (options_.ipc_endpoint.has_value() &&
+        !frontend_socket.bind(*options_.ipc_endpoint)) {
+        std::cerr << "Failed to bind the IPC responder socket\n";
+        return EXIT_FAILURE;
+    }
+
+    wrappers::zmq::socket backend_socket(ctx,
+                                         wrappers::zmq::socket::type::dealer);
+    if (!backend_socket.bind(backend_endpoint)) {
+        std::cerr << "Failed to bind the worker socket\n";
+        return EXIT_FAILURE;
+    }
+
+    std::optional<wrappers::zmq::socket> stats_socket;
+    if (options_.stats_port.has_value()) {
+        stats_socket.emplace(ctx, wrappers::zmq::socket::type::rep);
+        const auto stats_endpoint =
+            "tcp://*:" + std::to_string(*options_.stats_port);
+        if (!stats_socket->bind(stats_endpoint)) {
+            std::cerr << "Failed to bind the stats socket\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Workers publish into the XSUB side, subscribers attach to the XPUB
+    // side, and the main loop relays between them
+    std::optional<wrappers::zmq::socket> publish_frontend;
+    std::optional<wrappers::zmq::socket> publish_backend;
+    if (options_.publish_endpoint.has_value()) {
+        publish_frontend.emplace(ctx, wrappers::zmq::socket::type::xsub);
+        publish_backend.emplace(ctx, wrappers::zmq::socket::type::xpub);
+        if (!publish_frontend->bind(publish_endpoint) ||
+            !publish_backend->bind(*options_.publish_endpoint)) {
+            std::cerr << "Failed to bind the publisher socket "
+                      << *options_.publish_endpoint << "\n";
+            return EXIT_FAILURE;
+        }
+        stages_.publish = true;
+    }
+
+    wrappers::zmq::poller poller;
+    if (!poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in) ||
+        !poller.add(frontend_socket, wrappers::zmq::poll_event::in) ||
+        !poller.add(backend_socket, wrappers::zmq::poll_event::in)) {
+        std::cerr << "Failed to register the responder sockets\n";
+        return EXIT_FAILURE;
+    }
+
+    if (stats_socket.has_value() &&
+        !poller.add(*stats_socket, wrappers::zmq::poll_event::in)) {
+        std::cerr << "Failed to register the stats socket\n";
+        return EXIT_FAILURE;
+    }
+
+    if (stages_.publish &&
+        (!poller.add(*publish_frontend, wrappers::zmq::poll_event::in) ||
+         !poller.add(*publish_backend, wrappers::zmq::poll_event::in))) {
+        std::cerr << "Failed to register the publisher sockets\n";
+        return EXIT_FAILURE;
+    }
+
+    std::optional<link_analytics> analytics;
+    std::optional<wrappers::zmq::socket> analytics_socket;
+    if (options_.analytics_port.has_value()) {
+        analytics.emplace(options_.worker_count, options_.analytics_window);
+        stages_.analytics = &*analytics;
+
+        analytics_socket.emplace(ctx, wrappers::zmq::socket::type::rep);
+        if (!analytics_socket->bind(
+                "tcp://*:" + std::to_string(*options_.analytics_port)) ||
+            !poller.add(*analytics_socket, wrappers::zmq::poll_event::in)) {
+            std::cerr << "Failed to set up the analytics socket\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::optional<tracer> traces;
+    if (options_.trace_path.has_value()) {
+        traces.emplace(
+            *options_.trace_path, options_.worker_count, trace_capacity);
+        if (!traces->open()) {
+            std::cerr << "Failed to open the trace file "
+                      << *options_.trace_path << "\n";
+            return EXIT_FAILURE;
+        }
+        stages_.traces = &*traces;
+    }
+
+    metrics metrics_(options_.worker_count);
+
+    std::atomic<unsigned int> finished_workers = 0;
+    std::vector<std::thread> workers;
+    workers.reserve(options_.worker_count);
+    for (unsigned int i = 0; i < options_.worker_count; ++i) {
+        workers.emplace_back([&, i]() noexcept {
+            worker(ctx,
+                   stages_,
+                   i,
+                   metrics_.for_worker(i),
+                   *record_pools.at(i));
+            finished_workers.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(s_error_mutex);
+        std::cerr << "Press CTRL+C to cancel..." << std::endl;
+    }
+
+    int rc = EXIT_SUCCESS;
+    bool break_loop = false;
+
+    // Requests handed to the workers and not answered yet. A signal stops
+    // taking new requests, and the loop runs on until these are answered
+    // or the drain timeout expires.
+    std::uint64_t in_flight = 0;
+    std::optional<std::chrono::steady_clock::time_point> drain_deadline;
+    auto next_metrics_dump =
+        std::chrono::steady_clock::now() + options_.metrics_interval;
+    auto next_trace_flush =
+        std::chrono::steady_clock::now() + trace_flush_interval;
+    auto next_stream_expiry =
+        std::chrono::steady_clock::now() + stream_expiry_interval;
+
+    while (!break_loop) {
+        auto timeout = wrappers::zmq::poller::infinite;
+
+        if (options_.metrics_file.has_value()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= next_metrics_dump) {
+                if (!write_metrics_file(*options_.metrics_file, metrics_)) {
+                    std::cerr << "Failed to write the metrics to "
+                              << *options_.metrics_file << "\n";
+                }
+                next_metrics_dump = now + options_.metrics_interval;
+            }
+            timeout = std::chrono::ceil<std::chrono::milliseconds>(
+                next_metrics_dump - now);
+        }
+
+        if (traces.has_value()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= next_trace_flush) {
+                if (!traces->flush()) {
+                    std::cerr << "Failed to write the trace to "
+                              << *options_.trace_path << "\n";
+                }
+                next_trace_flush = now + trace_flush_interval;
+            }
+            const auto until_flush =
+                std::chrono::ceil<std::chrono::milliseconds>(
+                    next_trace_flush - now);
+            if (timeout == wrappers::zmq::poller::infinite ||
+                until_flush < timeout) {
+                timeout = until_flush;
+            }
+        }
+
+        if (streams.has_value()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= next_stream_expiry) {
+                const auto expired =
+                    streams->expire(options_.stream_idle_timeout);
+                if (expired > 0) {
+                    std::cerr << "Dropped " << expired
+                              << " incomplete streams that went idle\n";
+                }
+                next_stream_expiry = now + stream_expiry_interval;
+            }
+            const auto until_expiry =
+                std::chrono::ceil<std::chrono::milliseconds>(
+                    next_stream_expiry - now);
+            if (timeout == wrappers::zmq::poller::infinite ||
+                until_expiry < timeout) {
+                timeout = until_expiry;
+            }
+        }
+
+        if (drain_deadline.has_value()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (in_flight == 0) {
+                break;
+            }
+            if (now >= *drain_deadline) {
+                std::cerr << "Stopping with " << in_flight
+                          << " requests still unanswered\n";
+                break;
+            }
+            const auto until_deadline =
+                std::chrono::ceil<std::chrono::milliseconds>(*drain_deadline -
+                                                             now);
+            if (timeout == wrappers::zmq::poller::infinite ||
+                until_deadline < timeout) {
+                timeout = until_deadline;
+            }
+        }
+
+        const auto maybe_responses = poller.wait(timeout);
+
+        if (!maybe_responses.has_value()) {
+            std::cerr << "Failure in zmq_poller_wait_all, killing server...\n";
+            rc = EXIT_FAILURE;
+            break;
+        }
+
+        for (const auto &response : *maybe_responses) {
+            if (response.response_event != wrappers::zmq::poll_event::in) {
+                continue;
+            }
+
+            if (signals.raised_in(response)) {
+                // A second signal cuts the drain short, and is left
+                // pending so the outputs are not flushed either
+                if (drain_deadline.has_value()) {
+                    break_loop = true;
+                    break;
+                }
+
+                signals.reset();
+                if (in_flight == 0) {
+                    break_loop = true;
+                    break;
+                }
+                if (!poller.remove(frontend_socket)) {
+                    break_loop = true;
+                    break;
+                }
+                drain_deadline = std::chrono::steady_clock::now() +
+                                 options_.drain_timeout;
+                std::cerr << "Finishing " << in_flight
+                          << " requests in flight...\n";
+                continue;
+            }
+
+            if (stats_socket.has_value() &&
+                response.response_socket == &*stats_socket) {
+                if (!stats_socket->blocking_receive().has_value() ||
+                    !stats_socket->blocking_send(
+                        wrappers::zmq::message(metrics_.to_prometheus()))) {
+                    std::cerr << "Failed to answer a stats request\n";
+                }
+                continue;
+            }
+
+            if (analytics_socket.has_value() &&
+                response.response_socket == &*analytics_socket) {
+                if (!analytics_socket->blocking_receive().has_value() ||
+                    !analytics_socket->blocking_send(
+                        wrappers::zmq::message(analytics->to_json()))) {
+                    std::cerr << "Failed to answer an analytics request\n";
+                }
+                continue;
+            }
+
+            // Items go out to subscribers, subscriptions back to the
+            // workers' PUB sockets
+            if (stages_.publish &&
+                response.response_socket == &*publish_frontend) {
+                if (!publish_frontend->forward(*publish_backend)) {
+                    std::cerr << "Failed to relay a published item\n";
+                }
+                continue;
+            }
+
+            if (stages_.publish &&
+                response.response_socket == &*publish_backend) {
+                if (!publish_backend->forward(*publish_frontend)) {
+                    std::cerr << "Failed to relay a subscription\n";
+                }
+                continue;
+            }
+
+            if (response.response_socket == &frontend_socket) {
+                if (!frontend_socket.forward(backend_socket)) {
+                    std::cerr << "Failed to forward request to the workers, "
+                                 "killing server...\n";
+                    rc = EXIT_FAILURE;
+                    break_loop = true;
+                    break;
+                }
+                ++in_flight;
+            }
+
+            if (response.response_socket == &backend_socket) {
+                if (!backend_socket.forward(frontend_socket)) {
+                    std::cerr << "Failed to forward reply to the client, "
+                                 "killing server...\n";
+                    rc = EXIT_FAILURE;
+                    break_loop = true;
+                    break;
+                }
+                if (in_flight > 0) {
+                    --in_flight;
+                }
+            }
+        }
+    }
+
+    ctx.shutdown();
+
+    // The outputs get as long again to be flushed. Workers blocked on a
+    // full output queue only return once it makes room, so a stalled
+    // output is given up at the deadline, or on another signal.
+    const auto flush_deadline =
+        std::chrono::steady_clock::now() + options_.drain_timeout;
+    wrappers::zmq::poller signal_poller;
+    const bool watch_signals =
+        signal_poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in);
+
+    const auto wait_until = [&](const auto &done) {
+        while (!done()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= flush_deadline) {
+                return false;
+            }
+            const auto maybe_responses = signal_poller.wait(std::min(
+                shutdown_poll_interval,
+                std::chrono::ceil<std::chrono::milliseconds>(flush_deadline -
+                                                             now)));
+            if (watch_signals &&
+                (!maybe_responses.has_value() || !maybe_responses->empty())) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    bool output_flushed = wait_until([&]() {
+        return finished_workers.load(std::memory_order_acquire) ==
+               options_.worker_count;
+    });
+    if (output_flushed) {
+        output.finish();
+        output_flushed = wait_until([&]() { return output.finished(); });
+    }
+    if (!output_flushed) {
+        const auto discarded = output.abandon();
+        std::cerr << "Gave up on the output, discarding " << discarded
+                  << " records\n";
+    }
+
+    for (auto &worker_thread : workers) {
+        worker_thread.join();
+    }
+
+    if (link_store.has_value()) {
+        link_store->finish();
+        if (!wait_until([&]() { return link_store->finished(); })) {
+            const auto discarded = link_store->abandon();
+            std::cerr << "Gave up on the link store, discarding "
+                      << discarded << " records\n";
+        }
+    }
+
+    if (traces.has_value() && traces->dropped() > 0) {
+        std::cerr << "Dropped " << traces->dropped()
+                  << " trace spans that did not fit the buffers\n";
+    }
+
+    if (dedup.has_value()) {
+        std::cerr << "Suppressed " << dedup->hits() << " duplicates of "
+                  << dedup->hits() + dedup->misses() << " items\n";
+    }
+
+    return rc;
+}
+
+} // namespace linkollector::responder
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "sink.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace wrappers::zmq {
+class context;
+} // namespace wrappers::zmq
+
+namespace linkollector::signal_helper {
+class sigint_guard;
+} // namespace linkollector::signal_helper
+
+namespace linkollector::responder {
+
+struct options final {
+    unsigned int worker_count = 1;
+
+    // Where and how accepted items are written
+    sink::format output_format = sink::format::text;
+    sink::target output_target = sink::target::standard_output;
+    std::string output_path;
+    std::size_t output_queue_capacity = 4096;
+    wait_strategy output_wait = wait_strategy::block;
+    overflow_policy output_overflow = overflow_policy::wait;
+
+    // URLs are canonicalized in place and malformed ones rejected before
+    // any later stage sees them
+    bool canonicalize_urls = false;
+
+    // Items seen again within this window are acknowledged but dropped
+    std::optional<std::chrono::milliseconds> dedup_window;
+    std::size_t dedup_memory = 16U * 1024U * 1024U;
+
+    // Accepted items are appended to a link store in this directory
+    // before they are acknowledged. Unless acknowledgements wait for the
+    // sync, a crash loses up to one fsync interval of acknowledged items.
+    std::optional<std::string> store_directory;
+    std::uint64_t store_segment_size = 64U * 1024U * 1024U;
+    std::chrono::milliseconds store_fsync_interval{100};
+    bool store_sync_acks = false;
+
+    // Chunked items are reassembled into files in this directory, and
+    // rejected without one. Items that receive no chunk for the idle
+    // timeout are given up and their partial files deleted.
+    std::optional<std::string> stream_directory;
+    std::chrono::seconds stream_idle_timeout{60};
+
+    // Accepted items are republished on a PUB socket bound here, with the
+    // activity ("URL" or "TEXT") as the topic frame
+    std::optional<std::string> publish_endpoint;
+
+    // URLs are counted per domain and distinct link over tumbling windows,
+    // queried as JSON through a REP socket on this port
+    std::optional<std::uint16_t> analytics_port;
+    std::chrono::seconds analytics_window{3600};
+
+    // A REP socket on this port answers any request with a metrics snapshot
+    std::optional<std::uint16_t> stats_port;
+
+    // Metrics are periodically written to this file in Prometheus format
+    std::optional<std::string> metrics_file;
+    std::chrono::milliseconds metrics_interval{10000};
+
+    // Spans of requests the sender traced are written here as Chrome
+    // trace_event JSON
+    std::optional<std::string> trace_path;
+
+    // The frontend is also bound to this ipc:// endpoint, for senders on
+    // the same machine
+    std::optional<std::string> ipc_endpoint;
+
+    // On SIGINT or SIGTERM, requests already handed to the workers get
+    // this long to be answered, and the output and link store as long
+    // again to be flushed, before what is left is discarded
+    std::chrono::milliseconds drain_timeout{5000};
+};
+
+[[nodiscard]] int run(wrappers::zmq::context &ctx,
+                      signal_helper::sigint_guard &signals,
+                      const options &options_) noexcept;
+
+} // namespace linkollector::responder
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#endif
+
+namespace linkollector {
+
+// Keeps the producer and consumer indices of a ring off each other's
+// cache lines
+constexpr std::size_t cache_line_size = 64;
+
+// How a thread waits for a ring to become ready
+enum class wait_strategy {
+    // Spin briefly, then sleep until notified
+    block,
+    // Never sleep: lowest latency, but burns a core while idle
+    spin
+};
+
+// What a producer does when the ring is full
+enum class overflow_policy {
+    // Wait for the consumer, pushing back on whoever feeds the producer
+    wait,
+    // Discard the item
+    drop
+};
+
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+[[nodiscard]] inline std::size_t
+ring_capacity(std::size_t requested) noexcept {
+    std::size_t capacity = 2;
+    while (capacity < requested) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Bounded single-producer single-consumer queue. Each side caches the
+// other's index and only reloads it when the ring looks full or empty, so
+// a steady stream costs one shared cache line transfer per wrap rather
+// than per item. Capacity is rounded up to a power of two.
+template <typename T> class spsc_ring final {
+
+public:
+    explicit spsc_ring(std::size_t capacity) noexcept
+        : m_slots(ring_capacity(capacity)), m_mask(m_slots.size() - 1) {}
+    spsc_ring(const spsc_ring &other) = delete;
+    spsc_ring &operator=(const spsc_ring &other) = delete;
+    spsc_ring(spsc_ring &&other) noexcept = delete;
+    spsc_ring &operator=(spsc_ring &&other) noexcept = delete;
+    ~spsc_ring() noexcept = default;
+
+    [[nodiscard]] std::size_t capacity() const noexcept {
+        return this->m_slots.size();
+    }
+
+    // Producer only. Moves from value on success.
+    [[nodiscard]] bool try_push(T &value) noexcept {
+        const auto tail = this->m_tail.load(std::memory_order_relaxed);
+
+        if (tail - this->m_cached_head == this->m_slots.size()) {
+            this->m_cached_head =
+                this->m_head.load(std::memory_order_acquire);
+            if (tail - this->m_cached_head == this->m_slots.size()) {
+                return false;
+            }
+        }
+
+        this->m_slots[tail & this->m_mask] = std::move(value);
+        this->m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only.
+    [[nodiscard]] bool try_pop(T &value) noexcept {
+        const auto head = this->m_head.load(std::memory_order_relaxed);
+
+        if (head == this->m_cached_tail) {
+            this->m_cached_tail =
+                this->m_tail.load(std::memory_order_acquire);
+            if (head == this->m_cached_tail) {
+                return false;
+            }
+        }
+
+        value = std::move(this->m_slots[head & this->m_mask]);
+        this->m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only.
+    [[nodiscard]] bool empty() const noexcept {
+        return this->m_head.load(std::memory_order_relaxed) ==
+               this->m_tail.load(std::memory_order_acquire);
+    }
+
+    // Producer only.
+    [[nodiscard]] bool full() const noexcept {
+        return this->m_tail.load(std::memory_order_relaxed) -
+                   this->m_head.load(std::memory_order_acquire) ==
+               this->m_slots.size();
+    }
+
+private:
+    std::vector<T> m_slots;
+    std::size_t m_mask;
+
+    alignas(cache_line_size) std::atomic<std::size_t> m_head = 0;
+    std::size_t m_cached_tail = 0;
+
+    alignas(cache_line_size) std::atomic<std::size_t> m_tail = 0;
+    std::size_t m_cached_head = 0;
+};
+
+// Bounded multi-producer single-consumer queue. Producers claim a slot
+// with a compare-and-swap on the tail; each slot carries a sequence number
+// telling whether it is free for the lap a producer is on or holds an item
+// for the consumer (Vyukov's bounded queue). Capacity is rounded up to a
+// power of two.
+template <typename T> class mpsc_ring final {
+
+public:
+    explicit mpsc_ring(std::size_t capacity) noexcept
+        : m_slots(ring_capacity(capacity)), m_mask(m_slots.size() - 1) {
+        for (std::size_t i = 0; i < this->m_slots.size(); ++i) {
+            this->m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    mpsc_ring(const mpsc_ring &other) = delete;
+    mpsc_ring &operator=(const mpsc_ring &other) = delete;
+    mpsc_ring(mpsc_ring &&other) noexcept = delete;
+    mpsc_ring &operator=(mpsc_ring &&other) noexcept = delete;
+    ~mpsc_ring() noexcept = default;
+
+    [[nodiscard]] std::size_t capacity() const noexcept {
+        return this->m_slots.size();
+    }
+
+    // Any thread. Moves from value on success.
+    [[nodiscard]] bool try_push(T &value) noexcept {
+        auto tail = this->m_tail.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto &slot_ = this->m_slots[tail & this->m_mask];
+            const auto sequence =
+                slot_.sequence.load(std::memory_order_acquire);
+
+            const auto lag = static_cast<std::ptrdiff_t>(sequence - tail);
+
+            if (lag == 0) {
+                if (this->m_tail.compare_exchange_weak(
+                        tail, tail + 1, std::memory_order_relaxed)) {
+                    slot_.value = std::move(value);
+                    slot_.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                // The slot still holds the item pushed a lap ago
+                return false;
+            } else {
+                tail = this->m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only.
+    [[nodiscard]] bool try_pop(T &value) noexcept {
+        auto &slot_ = this->m_slots[this->m_head & this->m_mask];
+        if (slot_.sequence.load(std::memory_order_acquire) !=
+            this->m_head + 1) {
+            return false;
+        }
+
+        value = std::move(slot_.value);
+        slot_.sequence.store(this->m_head + this->m_slots.size(),
+                             std::memory_order_release);
+        ++this->m_head;
+        return true;
+    }
+
+    // Consumer only.
+    [[nodiscard]] bool empty() const noexcept {
+        return this->m_slots[this->m_head & this->m_mask].sequence.load(
+                   std::memory_order_acquire) != this->m_head + 1;
+    }
+
+private:
+    struct slot final {
+        std::atomic<std::size_t> sequence = 0;
+        T value;
+    };
+
+    std::vector<slot> m_slots;
+    std::size_t m_mask;
+
+    // Owned by the consumer
+    alignas(cache_line_size) std::size_t m_head = 0;
+
+    alignas(cache_line_size) std::atomic<std::size_t> m_tail = 0;
+};
+
+// Lets a thread wait for a condition on a ring without putting a lock on
+// the other side's fast path: notify() only takes the mutex when someone
+// is asleep.
+class wait_point final {
+
+public:
+    explicit wait_point(wait_strategy strategy) noexcept
+        : m_strategy(strategy) {}
+    wait_point(const wait_point &other) = delete;
+    wait_point &operator=(const wait_point &other) = delete;
+    wait_point(wait_point &&other) noexcept = delete;
+    wait_point &operator=(wait_point &&other) noexcept = delete;
+    ~wait_point() noexcept = default;
+
+    // Returns once ready() is true. ready() may be called many times.
+    template <typename Predicate> void wait(Predicate ready) noexcept {
+        constexpr int spin_limit = 128;
+
+        for (int i = 0; i < spin_limit; ++i) {
+            if (ready()) {
+                return;
+            }
+            cpu_relax();
+        }
+
+        // Yielding now and then keeps an oversubscribed machine from
+        // running the spinner while the thread it waits for cannot run
+        if (this->m_strategy == wait_strategy::spin) {
+            for (unsigned int i = 1; !ready(); ++i) {
+                if (i % 1024 == 0) {
+                    std::this_thread::yield();
+                } else {
+                    cpu_relax();
+                }
+            }
+            return;
+        }
+
+        // Announce the sleeper before the last check: either notify()
+        // sees it, or the check sees what notify() was called for
+        this->m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            this->m_condition.wait(lock, ready);
+        }
+        this->m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Call after making a waiter's condition true.
+    void notify() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (this->m_sleepers.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+
+        const std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_condition.notify_all();
+    }
+
+private:
+    wait_strategy m_strategy;
+    std::atomic<unsigned int> m_sleepers = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+} // namespace linkollector
@@ -0,0 +1,961 @@
+#include "sender.h"
+
+#include "balancer.h"
+#include "metrics.h"
+#include "outbox.h"
+#include "protocol.h"
+#include "signal_helper.h"
+#include "tracer.h"
+#include "wrappers/zmq/context.h"
+#include "wrappers/zmq/message.h"
+#include "wrappers/zmq/poller.h"
+#include "wrappers/zmq/socket.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace linkollector::sender {
+
+std::string endpoint_for(const std::string &server) {
+    if (server.rfind("ipc://", 0) == 0) {
+        return server;
+    }
+    return "tcp://" + server + ":17729";
+}
+
+std::optional<std::vector<std::string>> parse_servers(std::string_view list) {
+    std::vector<std::string> servers;
+
+    while (true) {
+        const auto comma = list.find(',');
+        const auto server = list.substr(0, comma);
+        if (server.empty()) {
+            return std::nullopt;
+        }
+        servers.emplace_back(server);
+
+        if (comma == std::string_view::npos) {
+            return {std::move(servers)};
+        }
+        list.remove_prefix(comma + 1);
+    }
+}
+
+bool send_v2(wrappers::zmq::socket &requester_socket,
+             activity activity_,
+             std::string &&payload,
+             std::uint8_t flags) noexcept {
+    const auto header_bin =
+        protocol::v2::serialize_header(activity_, payload.size(), flags);
+    wrappers::zmq::message header(header_bin.size());
+    std::copy(std::begin(header_bin),
+              std::end(header_bin),
+              std::begin(header.data()));
+
+    return requester_socket.blocking_send_more(std::move(header)) &&
+           requester_socket.blocking_send(
+               wrappers::zmq::message(std::move(payload)));
+}
+
+// Prefixes item with a trace context stamped with the current time, for
+// requests sent with the trace flag.
+[[nodiscard]] static std::string traced_payload(std::uint64_t trace_id,
+                                                std::string_view item) {
+    const auto context =
+        protocol::v2::serialize_trace_context({trace_id, tracer::now()});
+
+    std::string payload(context.size() + item.size(), '\0');
+    std::transform(std::begin(context),
+                   std::end(context),
+                   std::begin(payload),
+                   [](std::byte byte) { return static_cast<char>(byte); });
+    std::copy(std::begin(item),
+              std::end(item),
+              std::next(std::begin(payload),
+                        static_cast<std::ptrdiff_t>(context.size())));
+    return payload;
+}
+
+[[nodiscard]] static std::uint64_t random_trace_id() noexcept {
+    std::random_device random;
+    return (std::uint64_t{random()} << 32U) | std::uint64_t{random()};
+}
+
+int send(wrappers::zmq::context &ctx,
+         const signal_helper::sigint_guard &signals,
+         const std::vector<std::string> &servers,
+         activity activity_,
+         const std::string &message,
+         unsigned int protocol_version,
+         std::chrono::milliseconds timeout,
+         unsigned int attempts,
+         bool trace) noexcept {
+    using clock = std::chrono::steady_clock;
+
+    std::cout << "Sending " << activity_to_string(activity_) << " \""
+              << message << "\" to hello world server...\n";
+
+    // Only v2 requests have room for a trace context
+    const bool traced = trace && protocol_version == protocol::v2::version;
+    const auto trace_id = traced ? random_trace_id() : 0;
+    if (traced) {
+        std::cout << "Trace id " << std::hex << trace_id << std::dec << "\n";
+    }
+
+    const auto start = clock::now();
+
+    // A REQ socket that lost its request can neither send nor receive
+    // again, so every attempt starts over with a new one, on the next
+    // server
+    for (unsigned int attempt = 1; attempt <= attempts; ++attempt) {
+        const auto &server = servers[(attempt - 1) % servers.size()];
+        wrappers::zmq::socket tcp_requester_socket(
+            ctx, wrappers::zmq::socket::type::req);
+        if (!tcp_requester_socket.connect(endpoint_for(server))) {
+            std::cerr << "Failed to connect the TCP requester socket\n";
+            return EXIT_FAILURE;
+        }
+
+        bool did_send = false;
+        if (traced) {
+            did_send = send_v2(tcp_requester_socket,
+                               activity_,
+                               traced_payload(trace_id, message),
+                               protocol::v2::trace_flag);
+        } else if (protocol_version == protocol::v2::version) {
+            did_send =
+                send_v2(tcp_requester_socket, activity_, std::string(message));
+        } else {
+            did_send = tcp_requester_socket.blocking_send(
+                wrappers::zmq::message(
+                    protocol::serialize(activity_, message)));
+        }
+
+        if (!did_send) {
+            std::cerr << "Failed to send data to the TCP requester socket\n";
+            return EXIT_FAILURE;
+        }
+
+        wrappers::zmq::poller poller;
+        if (!poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in) ||
+            !poller.add(tcp_requester_socket, wrappers::zmq::poll_event::in)) {
+            std::cerr << "Failed to register the client sockets\n";
+            return EXIT_FAILURE;
+        }
+
+        const auto deadline = clock::now() + timeout;
+
+        for (auto now = clock::now(); now < deadline; now = clock::now()) {
+            const auto maybe_responses = poller.wait(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - now));
+
+            if (!maybe_responses.has_value()) {
+                std::cerr
+                    << "Failure in zmq_poller_wait_all, killing client...\n";
+                return EXIT_FAILURE;
+            }
+
+            for (const auto &response : *maybe_responses) {
+                if (response.response_event != wrappers::zmq::poll_event::in) {
+                    continue;
+                }
+
+                if (signals.raised_in(response)) {
+                    return EXIT_SUCCESS;
+                }
+
+                if (!tcp_requester_socket.async_receive(nullptr, nullptr)) {
+                    std::cerr
+                        << "Failure in zmq_msg_recv, killing client...\n";
+                    return EXIT_FAILURE;
+                }
+
+                const auto round_trip =
+                    std::chrono::duration<double, std::milli>(clock::now() -
+                                                              start);
+                std::cout << "Acknowledged in " << round_trip.count()
+                          << " ms\n";
+                return EXIT_SUCCESS;
+            }
+        }
+
+        std::cerr << "No answer from " << server << " within "
+                  << timeout.count() << " ms (attempt " << attempt << " of "
+                  << attempts << ")\n";
+    }
+
+    std::cerr << "Giving up after " << attempts << " attempts\n";
+    return EXIT_FAILURE;
+}
+
+// Receives one reply envelope on a DEALER socket: the empty delimiter frame
+// the REP worker expects, followed by the status frame.
+[[nodiscard]] static std::optional<protocol::v2::status>
+receive_reply(wrappers::zmq::socket &dealer_socket,
+              wrappers::zmq::message &frame) noexcept {
+    std::optional<protocol::v2::status> status;
+
+    do {
+        if (!dealer_socket.blocking_receive(frame)) {
+            return std::nullopt;
+        }
+
+        if (frame.size() == 1) {
+            status = static_cast<protocol::v2::status>(
+                std::to_integer<std::uint8_t>(frame.data()[0]));
+        }
+    } while (frame.more());
+
+    return {status.value_or(protocol::v2::status::rejected)};
+}
+
+// Prints the spread of round trips recorded in nanoseconds
+static void print_latency(const histogram &round_trips,
+                          std::chrono::nanoseconds min,
+                          std::chrono::nanoseconds max) {
+    if (round_trips.count() == 0) {
+        return;
+    }
+
+    const auto in_ms = [](auto nanoseconds) {
+        return static_cast<double>(nanoseconds) / 1e6;
+    };
+    // Bucket bounds may overshoot the largest value actually seen
+    const auto at = [&round_trips, &max](double quantile) {
+        return std::min(round_trips.value_at_quantile(quantile),
+                        static_cast<std::uint64_t>(max.count()));
+    };
+
+    std::cout << "Round trip (ms): min " << in_ms(min.count()) << ", p50 "
+              << in_ms(at(0.5)) << ", p90 " << in_ms(at(0.9)) << ", p99 "
+              << in_ms(at(0.99)) << ", p99.9 " << in_ms(at(0.999))
+              << ", max " << in_ms(max.count()) << ", mean "
+              << in_ms(round_trips.sum()) /
+                     static_cast<double>(round_trips.count())
+              << "\n";
+}
+
+int send_batch(wrappers::zmq::context &ctx,
+               const signal_helper::sigint_guard &signals,
+               const std::vector<std::string> &servers,
+               balancer::policy policy,
+               activity activity_,
+               std::istream &input,
+               char delimiter,
+               unsigned int window,
+               std::chrono::milliseconds timeout,
+               unsigned int attempts,
+               bool report_latency,
+               bool trace) noexcept {
+    using clock = balancer::clock;
+
+    // Kept until answered, so it can be sent again to another server
+    struct request final {
+        std::uint64_t id;
+        clock::time_point first_sent_at;
+        clock::time_point sent_at;
+        std::string item;
+        std::size_t server;
+        unsigned int sends;
+        bool answered;
+    };
+
+    wrappers::zmq::poller poller;
+    if (!poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in)) {
+        std::cerr << "Failed to register the client sockets\n";
+        return EXIT_FAILURE;
+    }
+
+    balancer servers_(ctx, poller, servers, policy);
+    if (!servers_.connect()) {
+        std::cerr << "Failed to connect the TCP dealer sockets\n";
+        return EXIT_FAILURE;
+    }
+
+    // Trace ids of a batch follow the request ids
+    const auto first_trace_id = trace ? random_trace_id() : 0;
+
+    // [id] [empty] [header] [payload]: the REP worker hands back every
+    // frame before the delimiter, so answers can be matched to requests
+    const auto send_request = [&](request &request_) {
+        request_.server = servers_.pick(clock::now());
+        auto &dealer = servers_.socket(request_.server);
+
+        wrappers::zmq::message id(sizeof(request_.id));
+        std::memcpy(id.data().data(), &request_.id, sizeof(request_.id));
+        auto payload =
+            trace ? traced_payload(first_trace_id + request_.id, request_.item)
+                  : request_.item;
+
+        if (!dealer.blocking_send_more(std::move(id)) ||
+            !dealer.blocking_send_more(wrappers::zmq::message()) ||
+            !send_v2(dealer,
+                     activity_,
+                     std::move(payload),
+                     trace ? protocol::v2::trace_flag : 0)) {
+            return false;
+        }
+
+        servers_.sent(request_.server);
+        request_.sent_at = clock::now();
+        ++request_.sends;
+        return true;
+    };
+
+    const auto start = clock::now();
+
+    std::deque<request> requests;
+    std::uint64_t next_id = 0;
+    std::uint64_t sent = 0;
+    std::uint64_t acknowledged = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t resent = 0;
+    unsigned int in_flight = 0;
+    bool input_done = false;
+    bool interrupted = false;
+    bool gave_up = false;
+
+    histogram round_trips;
+    auto min_round_trip = std::chrono::nanoseconds::max();
+    auto max_round_trip = std::chrono::nanoseconds::zero();
+
+    wrappers::zmq::message frame;
+
+    while (!interrupted && !gave_up && (!input_done || in_flight > 0)) {
+        while (!input_done && in_flight < window) {
+            std::string item;
+            if (!std::getline(input, item, delimiter)) {
+                input_done = true;
+                break;
+            }
+
+            if (item.empty()) {
+                continue;
+            }
+
+            const auto now = clock::now();
+            requests.push_back({next_id++, now, now, std::move(item), 0, 0,
+                                false});
+            if (!send_request(requests.back())) {
+                requests.pop_back();
+                ++errors;
+                continue;
+            }
+
+            ++sent;
+            ++in_flight;
+        }
+
+        if (in_flight == 0) {
+            continue;
+        }
+
+        // Wait no longer than the oldest request may stay unanswered
+        auto deadline = clock::time_point::max();
+        for (const auto &request_ : requests) {
+            if (!request_.answered) {
+                deadline = std::min(deadline, request_.sent_at + timeout);
+            }
+        }
+
+        const auto remaining = std::max(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - clock::now()),
+            std::chrono::milliseconds(0));
+        const auto maybe_responses = poller.wait(remaining);
+
+        if (!maybe_responses.has_value()) {
+            std::cerr << "Failure in zmq_poller_wait_all, killing client...\n";
+            break;
+        }
+
+        for (const auto &response : *maybe_responses) {
+            if (response.response_event != wrappers::zmq::poll_event::in) {
+                continue;
+            }
+
+            if (signals.raised_in(response)) {
+                interrupted = true;
+                break;
+            }
+
+            const auto maybe_server =
+                servers_.index_of(response.response_socket);
+            if (!maybe_server.has_value()) {
+                continue;
+            }
+            auto &dealer = servers_.socket(*maybe_server);
+
+            // [id] [empty] [status]
+            if (!dealer.blocking_receive(frame)) {
+                std::cerr << "Failure in zmq_msg_recv, killing client...\n";
+                interrupted = true;
+                break;
+            }
+            std::optional<std::uint64_t> id;
+            if (frame.size() == sizeof(std::uint64_t)) {
+                id.emplace();
+                std::memcpy(&*id, frame.data().data(), sizeof(*id));
+            }
+            const auto maybe_status = receive_reply(dealer, frame);
+
+            if (!maybe_status.has_value()) {
+                std::cerr << "Failure in zmq_msg_recv, killing client...\n";
+                interrupted = true;
+                break;
+            }
+
+            const auto matching_request =
+                std::find_if(std::begin(requests),
+                             std::end(requests),
+                             [&id](const request &request_) {
+                                 return id == request_.id;
+                             });
+            if (matching_request == std::end(requests) ||
+                matching_request->answered ||
+                matching_request->server != *maybe_server) {
+                continue;
+            }
+
+            // Counted from the first send, so retries show in the tail
+            const auto round_trip =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - matching_request->first_sent_at);
+            round_trips.record(
+                static_cast<std::uint64_t>(round_trip.count()));
+            min_round_trip = std::min(min_round_trip, round_trip);
+            max_round_trip = std::max(max_round_trip, round_trip);
+
+            servers_.answered(*maybe_server);
+            matching_request->answered = true;
+            --in_flight;
+            ++acknowledged;
+
+            if (*maybe_status != protocol::v2::status::ok) {
+                ++errors;
+            }
+        }
+
+        // A server that let a request time out loses every request it
+        // holds; they go again to the servers still answering
+        const auto now = clock::now();
+        for (const auto &expired : requests) {
+            if (interrupted || gave_up) {
+                break;
+            }
+
+            if (expired.answered || now < expired.sent_at + timeout) {
+                continue;
+            }
+
+            // Every server had its chance at this item, so none is
+            // likely to answer the rest either
+            if (expired.sends >= attempts) {
+                std::cerr << "No answer after " << expired.sends
+                          << " attempts, giving up on " << in_flight
+                          << " items\n";
+                errors += in_flight;
+                gave_up = true;
+                break;
+            }
+
+            const auto server = expired.server;
+            if (!servers_.demote(server, now)) {
+                interrupted = true;
+                break;
+            }
+
+            for (auto &request_ : requests) {
+                if (request_.answered || request_.server != server) {
+                    continue;
+                }
+
+                if (!send_request(request_)) {
+                    std::cerr
+                        << "Failed to send data to the TCP dealer socket\n";
+                    interrupted = true;
+                    break;
+                }
+                ++resent;
+            }
+        }
+
+        while (!requests.empty() && requests.front().answered) {
+            requests.pop_front();
+        }
+    }
+
+    const auto seconds =
+        std::chrono::duration<double>(clock::now() - start).count();
+    const auto rate =
+        seconds > 0.0 ? static_cast<double>(acknowledged) / seconds : 0.0;
+
+    std::cout << "Sent " << sent << " items, " << acknowledged
+              << " acknowledged in " << seconds << " s (" << rate
+              << " messages/sec), " << resent << " resent, " << errors
+              << " errors\n";
+
+    if (servers_.size() > 1) {
+        for (std::size_t i = 0; i < servers_.size(); ++i) {
+            const auto &stats = servers_.stats(i);
+            std::cout << "  " << servers_.server(i) << ": " << stats.answered
+                      << " acknowledged, demoted " << stats.demotions
+                      << " times\n";
+        }
+    }
+
+    if (report_latency) {
+        print_latency(round_trips, min_round_trip, max_round_trip);
+    }
+
+    return errors == 0 && !interrupted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int send_stream(wrappers::zmq::context &ctx,
+                const signal_helper::sigint_guard &signals,
+                const std::string &server,
+                activity activity_,
+                std::istream &input,
+                std::uint64_t size,
+                std::size_t chunk_size,
+                unsigned int window,
+                std::chrono::milliseconds timeout) noexcept {
+    wrappers::zmq::socket tcp_dealer_socket(
+        ctx, wrappers::zmq::socket::type::dealer);
+    if (!tcp_dealer_socket.connect(endpoint_for(server))) {
+        std::cerr << "Failed to connect the TCP dealer socket\n";
+        return EXIT_FAILURE;
+    }
+
+    wrappers::zmq::poller poller;
+    if (!poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in) ||
+        !poller.add(tcp_dealer_socket, wrappers::zmq::poll_event::in)) {
+        std::cerr << "Failed to register the client sockets\n";
+        return EXIT_FAILURE;
+    }
+
+    std::random_device random;
+    const auto stream_id =
+        (std::uint64_t{random()} << 32U) | std::uint64_t{random()};
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+
+    std::uint64_t offset = 0;
+    std::uint64_t acknowledged_bytes = 0;
+    std::uint64_t chunks = 0;
+    std::uint64_t errors = 0;
+    unsigned int in_flight = 0;
+    bool interrupted = false;
+    auto deadline = start + timeout;
+
+    wrappers::zmq::message frame;
+
+    while (!interrupted && errors == 0 && (offset < size || in_flight > 0)) {
+        while (offset < size && in_flight < window) {
+            const auto data_size = static_cast<std::size_t>(
+                std::min<std::uint64_t>(chunk_size, size - offset));
+            const auto descriptor = protocol::v2::serialize_chunk_descriptor(
+                {stream_id, offset, size});
+
+            // The buffer is handed to the message, no copy is made
+            std::string chunk(descriptor.size() + data_size, '\0');
+            std::transform(std::begin(descriptor),
+                           std::end(descriptor),
+                           std::begin(chunk),
+                           [](std::byte byte) {
+                               return static_cast<char>(byte);
+                           });
+            if (!input.read(std::next(chunk.data(),
+                                      static_cast<std::ptrdiff_t>(
+                                          descriptor.size())),
+                            static_cast<std::streamsize>(data_size))) {
+                std::cerr << "Failed to read the input\n";
+                ++errors;
+                break;
+            }
+
+            if (!tcp_dealer_socket.blocking_send_more(
+                    wrappers::zmq::message()) ||
+                !send_v2(tcp_dealer_socket,
+                         activity_,
+                         std::move(chunk),
+                         protocol::v2::chunk_flag)) {
+                std::cerr << "Failed to send data to the TCP dealer socket\n";
+                ++errors;
+                break;
+            }
+
+            if (in_flight == 0) {
+                deadline = clock::now() + timeout;
+            }
+            offset += data_size;
+            ++chunks;
+            ++in_flight;
+        }
+
+        if (errors > 0 || in_flight == 0) {
+            continue;
+        }
+
+        // Chunks are not sent again: the receiver would have to tell which
+        // ones it already has
+        const auto now = clock::now();
+        if (now >= deadline) {
+            std::cerr << "No answer from " << server << " within "
+                      << timeout.count() << " ms\n";
+            ++errors;
+            break;
+        }
+
+        const auto maybe_responses = poller.wait(
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline -
+                                                                  now));
+
+        if (!maybe_responses.has_value()) {
+            std::cerr << "Failure in zmq_poller_wait_all, killing client...\n";
+            break;
+        }
+
+        for (const auto &response : *maybe_responses) {
+            if (response.response_event != wrappers::zmq::poll_event::in) {
+                continue;
+            }
+
+            if (signals.raised_in(response)) {
+                interrupted = true;
+                break;
+            }
+
+            if (response.response_socket == &tcp_dealer_socket) {
+                const auto maybe_status =
+                    receive_reply(tcp_dealer_socket, frame);
+
+                if (!maybe_status.has_value()) {
+                    std::cerr
+                        << "Failure in zmq_msg_recv, killing client...\n";
+                    interrupted = true;
+                    break;
+                }
+
+                --in_flight;
+                deadline = clock::now() + timeout;
+
+                // The receiver cannot rebuild the item without every chunk
+                if (*maybe_status != protocol::v2::status::ok) {
+                    std::cerr << "The server rejected a chunk\n";
+                    ++errors;
+                    break;
+                }
+
+                acknowledged_bytes += std::min<std::uint64_t>(
+                    chunk_size, size - acknowledged_bytes);
+            }
+        }
+    }
+
+    const auto seconds =
+        std::chrono::duration<double>(clock::now() - start).count();
+    const auto rate = seconds > 0.0
+                          ? static_cast<double>(acknowledged_bytes) /
+                                (1024.0 * 1024.0) / seconds
+                          : 0.0;
+
+    std::cout << "Streamed " << acknowledged_bytes << " of " << size
+              << " bytes in " << chunks << " chunks in " << seconds << " s ("
+              << rate << " MiB/sec), " << errors << " errors\n";
+
+    return acknowledged_bytes == size && errors == 0 && !interrupted
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
+
+// Result of delivering an outbox as far as one claim allows
+struct outbox_delivery final {
+    std::uint64_t delivered = 0;
+    std::uint64_t rejected = 0;
+    bool gave_up = false;
+    bool interrupted = false;
+};
+
+// Delivers items until the outbox is empty, the server stays silent for
+// attempts timeouts in a row or the user interrupts. Every request carries
+// the offset of its item in an envelope frame before the delimiter, which
+// the REP worker hands back with the answer, so answers can be matched to
+// items whatever order they come back in.
+static void deliver_outbox(wrappers::zmq::context &ctx,
+                           const signal_helper::sigint_guard &signals,
+                           const std::string &server,
+                           outbox &outbox_,
+                           std::chrono::milliseconds timeout,
+                           unsigned int window,
+                           unsigned int attempts,
+                           outbox_delivery &delivery) noexcept {
+    using clock = std::chrono::steady_clock;
+    constexpr std::chrono::milliseconds initial_backoff(100);
+    constexpr std::chrono::milliseconds max_backoff(30000);
+
+    struct request final {
+        std::uint64_t offset;
+        std::uint64_t end;
+        bool answered;
+    };
+
+    std::deque<request> requests;
+    auto next_offset = outbox_.head();
+    auto tail = outbox_.tail();
+
+    std::optional<wrappers::zmq::socket> dealer;
+    wrappers::zmq::poller poller;
+    if (!poller.add_fd(signals.fd(), wrappers::zmq::poll_event::in)) {
+        std::cerr << "Failed to register the signal socket\n";
+        delivery.gave_up = true;
+        return;
+    }
+
+    // A fresh socket drops whatever the old one still had queued
+    const auto connect = [&]() {
+        if (dealer.has_value()) {
+            [[maybe_unused]] const bool removed = poller.remove(*dealer);
+        }
+        dealer.emplace(ctx, wrappers::zmq::socket::type::dealer);
+        return dealer->connect(endpoint_for(server)) &&
+               poller.add(*dealer, wrappers::zmq::poll_event::in);
+    };
+
+    if (!connect()) {
+        std::cerr << "Failed to connect the TCP dealer socket\n";
+        delivery.gave_up = true;
+        return;
+    }
+
+    std::minstd_rand jitter(std::random_device{}());
+    auto backoff = initial_backoff;
+    unsigned int failures = 0;
+    auto deadline = clock::now() + timeout;
+    wrappers::zmq::message frame;
+
+    while (true) {
+        while (requests.size() < window) {
+            if (next_offset >= tail) {
+                tail = outbox_.tail();
+                if (next_offset >= tail) {
+                    break;
+                }
+            }
+
+            auto maybe_item = outbox_.read(next_offset);
+            if (!maybe_item.has_value()) {
+                std::cerr << "The outbox is corrupt at offset " << next_offset
+                          << "\n";
+                delivery.gave_up = true;
+                return;
+            }
+
+            wrappers::zmq::message id(sizeof(std::uint64_t));
+            std::memcpy(id.data().data(), &next_offset, sizeof(next_offset));
+
+            if (!dealer->blocking_send_more(std::move(id)) ||
+                !dealer->blocking_send_more(wrappers::zmq::message()) ||
+                !send_v2(*dealer,
+                         maybe_item->item_activity,
+                         std::move(maybe_item->payload))) {
+                std::cerr << "Failed to send data to the TCP dealer socket\n";
+                delivery.gave_up = true;
+                return;
+            }
+
+            if (requests.empty()) {
+                deadline = clock::now() + timeout;
+            }
+            requests.push_back({next_offset, maybe_item->end, false});
+            next_offset = maybe_item->end;
+        }
+
+        if (requests.empty()) {
+            return;
+        }
+
+        const auto remaining = std::max(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - clock::now()),
+            std::chrono::milliseconds(0));
+        const auto maybe_responses = poller.wait(remaining);
+
+        if (!maybe_responses.has_value()) {
+            std::cerr << "Failure in zmq_poller_wait_all, killing client...\n";
+            delivery.gave_up = true;
+            return;
+        }
+
+        bool answered = false;
+
+        for (const auto &response : *maybe_responses) {
+            if (response.response_event != wrappers::zmq::poll_event::in) {
+                continue;
+            }
+
+            if (signals.raised_in(response)) {
+                delivery.interrupted = true;
+                return;
+            }
+
+            // [offset] [empty] [status]
+            if (!dealer->blocking_receive(frame)) {
+                delivery.gave_up = true;
+                return;
+            }
+            std::optional<std::uint64_t> offset;
+            if (frame.size() == sizeof(std::uint64_t)) {
+                offset.emplace();
+                std::memcpy(&*offset, frame.data().data(), sizeof(*offset));
+            }
+            const auto maybe_status = receive_reply(*dealer, frame);
+            if (!maybe_status.has_value()) {
+                delivery.gave_up = true;
+                return;
+            }
+
+            const auto matching_request = std::find_if(
+                std::begin(requests),
+                std::end(requests),
+                [&offset](const request &request_) {
+                    return offset == request_.offset;
+                });
+            if (matching_request == std::end(requests) ||
+                matching_request->answered) {
+                continue;
+            }
+
+            // A rejected item would be rejected again, drop it as well
+            matching_request->answered = true;
+            ++delivery.delivered;
+            if (*maybe_status != protocol::v2::status::ok) {
+                ++delivery.rejected;
+            }
+            answered = true;
+        }
+
+        if (answered) {
+            failures = 0;
+            backoff = initial_backoff;
+            deadline = clock::now() + timeout;
+
+            while (!requests.empty() && requests.front().answered) {
+                if (!outbox_.remove_until(requests.front().end)) {
+                    std::cerr << "Failed to update the outbox\n";
+                    delivery.gave_up = true;
+                    return;
+                }
+                requests.pop_front();
+            }
+
+            // The outbox starts over at the front once emptied
+            if (requests.empty()) {
+                next_offset = outbox_.head();
+                tail = outbox_.tail();
+            }
+            continue;
+        }
+
+        if (clock::now() < deadline) {
+            continue;
+        }
+
+        if (++failures >= attempts) {
+            delivery.gave_up = true;
+            return;
+        }
+
+        // Full jitter, a delay anywhere up to the backoff, keeps senders
+        // that failed together from retrying in lockstep
+        const auto delay = std::chrono::milliseconds(
+            std::uniform_int_distribution<std::chrono::milliseconds::rep>(
+                0, backoff.count())(jitter));
+        std::cerr << "No answer from " << server << ", retrying in "
+                  << delay.count() << " ms\n";
+        backoff = std::min(backoff * 2, max_backoff);
+
+        wrappers::zmq::poller signal_poller;
+        if (!signal_poller.add_fd(signals.fd(),
+                                  wrappers::zmq::poll_event::in)) {
+            delivery.gave_up = true;
+            return;
+        }
+        const auto maybe_signal = signal_poller.wait(delay);
+        if (!maybe_signal.has_value() || !maybe_signal->empty()) {
+            delivery.interrupted = true;
+            return;
+        }
+
+        if (!connect()) {
+            std::cerr << "Failed to connect the TCP dealer socket\n";
+            delivery.gave_up = true;
+            return;
+        }
+
+        requests.clear();
+        next_offset = outbox_.head();
+        deadline = clock::now() + timeout;
+    }
+}
+
+int send_outbox(wrappers::zmq::context &ctx,
+                const signal_helper::sigint_guard &signals,
+                const std::string &server,
+                outbox &outbox_,
+                std::chrono::milliseconds timeout,
+                unsigned int window,
+                unsigned int attempts) noexcept {
+    outbox_delivery delivery;
+
+    // Senders that appended while this one delivered leave their items to
+    // it, so check for them once more after letting go of the claim
+    while (outbox_.try_claim()) {
+        deliver_outbox(ctx,
+                       signals,
+                       server,
+                       outbox_,
+                       timeout,
+                       window,
+                       attempts,
+                       delivery);
+        outbox_.release_claim();
+
+        if (delivery.gave_up || delivery.interrupted ||
+            outbox_.head() == outbox_.tail()) {
+            break;
+        }
+    }
+
+    const auto left = outbox_.pending_count();
+
+    std::cout << "Delivered " << delivery.delivered
+              << " items from the outbox, " << delivery.rejected
+              << " rejected";
+    if (left > 0) {
+        std::cout << ", " << left << " left for a later run";
+    }
+    std::cout << "\n";
+
+    // Items left behind are safe on disk, which is all a sender needs
+    return delivery.rejected == 0 && !delivery.interrupted ? EXIT_SUCCESS
+                                                           : EXIT_FAILURE;
+}
+
+} // namespace linkollector::sender
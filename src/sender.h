@@ -0,0 +1,108 @@
+#pragma once
+
+#include "activity.h"
+#include "balancer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wrappers::zmq {
+class context;
+class socket;
+} // namespace wrappers::zmq
+
+namespace linkollector::signal_helper {
+class sigint_guard;
+} // namespace linkollector::signal_helper
+
+namespace linkollector {
+class outbox;
+} // namespace linkollector
+
+namespace linkollector::sender {
+
+// A host name or address reaches the responder's TCP port; an ipc://
+// endpoint is used as it is.
+[[nodiscard]] std::string endpoint_for(const std::string &server);
+
+// Splits a comma-separated list of servers. Returns nothing if a name is
+// empty.
+[[nodiscard]] std::optional<std::vector<std::string>>
+parse_servers(std::string_view list);
+
+// Sends a v2 request: the header frame, then payload as the last frame.
+[[nodiscard]] bool send_v2(wrappers::zmq::socket &requester_socket,
+                           activity activity_,
+                           std::string &&payload,
+                           std::uint8_t flags = 0) noexcept;
+
+// Sends one item on a REQ socket. When no answer comes within timeout, the
+// socket is replaced and the item sent again to the next server, up to
+// attempts times in all. Prints the round trip once answered. With trace,
+// the request carries a trace context, whose id is printed.
+[[nodiscard]] int send(wrappers::zmq::context &ctx,
+                       const signal_helper::sigint_guard &signals,
+                       const std::vector<std::string> &servers,
+                       activity activity_,
+                       const std::string &message,
+                       unsigned int protocol_version,
+                       std::chrono::milliseconds timeout,
+                       unsigned int attempts,
+                       bool trace) noexcept;
+
+// Sends every delimiter-separated item of input as its own v2 request,
+// keeping up to window requests in flight spread over servers by policy.
+// A server that leaves a request unanswered for timeout is demoted and its
+// unanswered items sent again elsewhere. The batch gives up once an item
+// went unanswered attempts times. With report_latency, prints the spread
+// of round trips, each counted from the first send. With trace, every
+// request carries a trace context.
+[[nodiscard]] int send_batch(wrappers::zmq::context &ctx,
+                             const signal_helper::sigint_guard &signals,
+                             const std::vector<std::string> &servers,
+                             balancer::policy policy,
+                             activity activity_,
+                             std::istream &input,
+                             char delimiter,
+                             unsigned int window,
+                             std::chrono::milliseconds timeout,
+                             unsigned int attempts,
+                             bool report_latency,
+                             bool trace) noexcept;
+
+// Sends size bytes of input as one item, split into chunks of chunk_size
+// bytes with up to window chunks in flight, so memory use is bounded by
+// window * chunk_size whatever the item size. Fails if no answer comes
+// within timeout.
+[[nodiscard]] int send_stream(wrappers::zmq::context &ctx,
+                              const signal_helper::sigint_guard &signals,
+                              const std::string &server,
+                              activity activity_,
+                              std::istream &input,
+                              std::uint64_t size,
+                              std::size_t chunk_size,
+                              unsigned int window,
+                              std::chrono::milliseconds timeout) noexcept;
+
+// Delivers the items of an outbox with up to window requests in flight,
+// removing each once the server has answered it. When no answer comes
+// within timeout, the connection is dropped and the unanswered items are
+// sent again on a new one after an exponential backoff; after attempts
+// failures in a row the rest is left for a later run. Items may be
+// delivered twice, but never lost. Fails only if the user interrupted or
+// the server rejected items.
+[[nodiscard]] int send_outbox(wrappers::zmq::context &ctx,
+                              const signal_helper::sigint_guard &signals,
+                              const std::string &server,
+                              outbox &outbox_,
+                              std::chrono::milliseconds timeout,
+                              unsigned int window,
+                              unsigned int attempts) noexcept;
+
+} // namespace linkollector::sender
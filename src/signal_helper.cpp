@@ -1,24 +1,102 @@
 #include "signal_helper.h"
 
+#include <cerrno>
 #include <csignal>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#elif defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace linkollector::signal_helper {
 
-static void *s_data = nullptr;
-static void (*s_callback)(void *) = nullptr;
+#ifdef _WIN32
+static constexpr wrappers::zmq::native_fd invalid_fd = INVALID_SOCKET;
+#else
+static constexpr wrappers::zmq::native_fd invalid_fd = -1;
+#endif
+
+static wrappers::zmq::native_fd s_write_fd = invalid_fd;
 
+// Nothing here may allocate or lock: only the write to the descriptor
 static void signal_handler([[maybe_unused]] int signal_value) noexcept {
-    s_callback(s_data);
+#ifdef _WIN32
+    // Windows runs the handler on a thread of its own
+    const char wakeup = 0;
+    send(s_write_fd, &wakeup, 1, 0);
+#else
+    const auto saved_errno = errno;
+#ifdef __linux__
+    const std::uint64_t wakeup = 1;
+#else
+    const char wakeup = 0;
+#endif
+    // A full pipe or saturated counter is already readable
+    [[maybe_unused]] const auto written =
+        write(s_write_fd, &wakeup, sizeof(wakeup));
+    errno = saved_errno;
+#endif
 }
 
-sigint_guard::sigint_guard(void *data, void (*callback)(void *)) {
-    s_data = data;
-    s_callback = callback;
-
+sigint_guard::sigint_guard() noexcept
+    : m_read_fd(invalid_fd), m_write_fd(invalid_fd) {
 #ifdef _WIN32
+    // A loopback UDP socket connected to itself stands in for the pipe
+    const SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) {
+        return;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int address_size = sizeof(address);
+    u_long non_blocking = 1;
+    auto *const generic_address = reinterpret_cast<sockaddr *>(&address);
+
+    if (bind(sock, generic_address, address_size) != 0 ||
+        getsockname(sock, generic_address, &address_size) != 0 ||
+        connect(sock, generic_address, address_size) != 0 ||
+        ioctlsocket(sock, FIONBIO, &non_blocking) != 0) {
+        closesocket(sock);
+        return;
+    }
+
+    this->m_read_fd = sock;
+    this->m_write_fd = sock;
+    s_write_fd = sock;
     std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
 #else
-    struct sigaction action;
+#ifdef __linux__
+    const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+    this->m_read_fd = fd;
+    this->m_write_fd = fd;
+#else
+    int fds[2];
+    if (pipe(fds) == -1) {
+        return;
+    }
+    for (const int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    this->m_read_fd = fds[0];
+    this->m_write_fd = fds[1];
+#endif
+
+    s_write_fd = this->m_write_fd;
+
+    struct sigaction action {};
     action.sa_handler = signal_handler;
     action.sa_flags = 0;
     sigemptyset(&action.sa_mask);
@@ -28,8 +106,52 @@ sigint_guard::sigint_guard(void *data, void (*callback)(void *)) {
 }
 
 sigint_guard::~sigint_guard() noexcept {
-    s_data = nullptr;
-    s_callback = nullptr;
+    if (!this->is_valid()) {
+        return;
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    s_write_fd = invalid_fd;
+
+#ifdef _WIN32
+    closesocket(this->m_read_fd);
+#else
+    close(this->m_read_fd);
+    if (this->m_write_fd != this->m_read_fd) {
+        close(this->m_write_fd);
+    }
+#endif
+}
+
+bool sigint_guard::is_valid() const noexcept {
+    return this->m_read_fd != invalid_fd;
+}
+
+wrappers::zmq::native_fd sigint_guard::fd() const noexcept {
+    return this->m_read_fd;
+}
+
+bool sigint_guard::raised_in(
+    const wrappers::zmq::poll_response &response) const noexcept {
+    return response.response_socket == nullptr &&
+           response.response_fd == this->m_read_fd;
+}
+
+void sigint_guard::reset() noexcept {
+    // Reads until the descriptor would block: an eventfd counter comes
+    // back whole, a pipe or socket one wakeup at a time
+    std::uint64_t buffer = 0;
+#ifdef _WIN32
+    while (recv(this->m_read_fd,
+                static_cast<char *>(static_cast<void *>(&buffer)),
+                sizeof(buffer),
+                0) > 0) {
+    }
+#else
+    while (read(this->m_read_fd, &buffer, sizeof(buffer)) > 0) {
+    }
+#endif
 }
 
 } // namespace linkollector::signal_helper
@@ -1,14 +1,40 @@
 #pragma once
 
+#include "wrappers/zmq/poll_response.h"
+
 namespace linkollector::signal_helper {
 
-struct sigint_guard final {
-    explicit sigint_guard(void *data, void (*callback)(void *));
+// Catches SIGINT and SIGTERM while it lives. The handler only writes to a
+// descriptor created up front, an eventfd on Linux and a self-pipe on
+// other systems, which event loops poll next to their sockets. It stays
+// readable from the first signal until reset(), so every loop polling it
+// sees the shutdown.
+class sigint_guard final {
+
+public:
+    explicit sigint_guard() noexcept;
     sigint_guard(const sigint_guard &other) = delete;
     sigint_guard &operator=(const sigint_guard &other) = delete;
-    sigint_guard(sigint_guard &&other) noexcept = default;
-    sigint_guard &operator=(sigint_guard &&other) noexcept = default;
+    sigint_guard(sigint_guard &&other) noexcept = delete;
+    sigint_guard &operator=(sigint_guard &&other) noexcept = delete;
     ~sigint_guard() noexcept;
+
+    // False if the descriptor could not be created, in which case the
+    // signals keep their default action
+    [[nodiscard]] bool is_valid() const noexcept;
+
+    [[nodiscard]] wrappers::zmq::native_fd fd() const noexcept;
+
+    // Whether a poll response is a signal having arrived
+    [[nodiscard]] bool
+    raised_in(const wrappers::zmq::poll_response &response) const noexcept;
+
+    // Forgets the signals caught so far, so the next one is seen again
+    void reset() noexcept;
+
+private:
+    wrappers::zmq::native_fd m_read_fd;
+    wrappers::zmq::native_fd m_write_fd;
 };
 
 } // namespace linkollector::signal_helper
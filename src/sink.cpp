@@ -0,0 +1,405 @@
+#include "sink.h"
+
+#include "json.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace linkollector {
+
+constexpr std::size_t max_batch_iovecs = 256;
+
+sink::sink(format format_,
+           std::size_t capacity,
+           wait_strategy wait_strategy_,
+           overflow_policy overflow_policy_) noexcept
+    : m_format(format_), m_overflow_policy(overflow_policy_),
+      m_queue(capacity), m_not_empty(wait_strategy_),
+      m_not_full(wait_strategy_) {}
+
+sink::~sink() noexcept {
+    if (this->m_writer.joinable()) {
+        this->finish();
+        this->m_writer.join();
+    }
+
+#ifndef _WIN32
+    if (this->m_original_flags != -1) {
+        ::fcntl(this->m_fd, F_SETFL, this->m_original_flags);
+    }
+    for (const int fd : {this->m_wake_read_fd, this->m_wake_write_fd}) {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+#endif
+
+    if (this->m_owns_fd) {
+#ifdef _WIN32
+        _close(this->m_fd);
+#else
+        ::close(this->m_fd);
+#endif
+    }
+}
+
+bool sink::open(target target_, const std::string &path) noexcept {
+#ifdef _WIN32
+    switch (target_) {
+    case target::standard_output:
+        this->m_fd = _fileno(stdout);
+        _setmode(this->m_fd, _O_BINARY);
+        break;
+    case target::file:
+        this->m_fd = _open(path.c_str(),
+                           _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY,
+                           _S_IREAD | _S_IWRITE);
+        this->m_owns_fd = true;
+        break;
+    case target::named_pipe:
+        std::cerr << "Named pipes are not supported on this platform\n";
+        return false;
+    }
+#else
+    switch (target_) {
+    case target::standard_output:
+        this->m_fd = STDOUT_FILENO;
+        break;
+    case target::file:
+        this->m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        this->m_owns_fd = true;
+        break;
+    case target::named_pipe:
+        if (::mkfifo(path.c_str(), 0644) == -1 && errno != EEXIST) {
+            return false;
+        }
+        std::cerr << "Waiting for a reader on " << path << "...\n";
+        this->m_fd = ::open(path.c_str(), O_WRONLY);
+        this->m_owns_fd = true;
+        break;
+    }
+#endif
+
+    if (this->m_fd == -1) {
+        this->m_owns_fd = false;
+        return false;
+    }
+
+#ifndef _WIN32
+    // A pipe whose reader stalls would block the writer for good, so pipes
+    // are written without blocking and waited on together with a wakeup
+    // pipe that abandon() writes to. The original flags are restored when
+    // done, as the standard output may be shared with other processes.
+    struct stat status {};
+    if (::fstat(this->m_fd, &status) == 0 &&
+        (S_ISFIFO(status.st_mode) || S_ISSOCK(status.st_mode))) {
+        this->m_original_flags = ::fcntl(this->m_fd, F_GETFL);
+        if (this->m_original_flags == -1 ||
+            ::fcntl(this->m_fd,
+                    F_SETFL,
+                    this->m_original_flags | O_NONBLOCK) == -1) {
+            return false;
+        }
+    }
+
+    std::array<int, 2> wake_fds = {-1, -1};
+    if (::pipe(wake_fds.data()) == -1) {
+        return false;
+    }
+    this->m_wake_read_fd = wake_fds[0];
+    this->m_wake_write_fd = wake_fds[1];
+#endif
+
+    this->m_writing.reserve(this->m_queue.capacity());
+    this->m_writer = std::thread([this]() noexcept {
+#ifndef _WIN32
+        // A reader going away must fail the write with EPIPE, not kill the
+        // process. Blocking the signal on this thread alone leaves the
+        // rest of the process alone.
+        sigset_t pipe_signal;
+        sigemptyset(&pipe_signal);
+        sigaddset(&pipe_signal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_signal, nullptr);
+#endif
+        this->write_loop();
+        this->m_finished.store(true, std::memory_order_release);
+    });
+    return true;
+}
+
+void sink::finish() noexcept {
+    this->m_stopping.store(true, std::memory_order_release);
+    this->m_not_empty.notify();
+}
+
+bool sink::finished() const noexcept {
+    return !this->m_writer.joinable() ||
+           this->m_finished.load(std::memory_order_acquire);
+}
+
+std::uint64_t sink::abandon() noexcept {
+    if (!this->m_writer.joinable()) {
+        return 0;
+    }
+
+    this->m_abandoned.store(true, std::memory_order_release);
+    this->m_failed.store(true, std::memory_order_release);
+    this->m_not_full.notify();
+    this->finish();
+
+#ifndef _WIN32
+    // Wakes a writer waiting for a stalled pipe. The byte stays unread, so
+    // a writer that only starts waiting afterwards returns at once.
+    const char wakeup = 0;
+    [[maybe_unused]] const auto woken =
+        ::write(this->m_wake_write_fd, &wakeup, sizeof(wakeup));
+#endif
+
+    this->m_writer.join();
+
+    auto discarded = this->m_discarded;
+    record record_;
+    while (this->m_queue.try_pop(record_)) {
+        ++discarded;
+    }
+    return discarded;
+}
+
+sink::write_result sink::write(activity activity_,
+                               std::string_view payload,
+                               buffer_pool *pool,
+                               std::pmr::memory_resource *arena) noexcept {
+    // After a failed write the output is gone, drop instead of blocking
+    if (this->m_failed.load(std::memory_order_acquire)) {
+        return write_result::dropped;
+    }
+
+    std::pmr::string formatted(arena != nullptr
+                                   ? arena
+                                   : std::pmr::get_default_resource());
+    this->format_record(formatted, activity_, payload);
+
+    record record_;
+    if (pool != nullptr) {
+        record_.pooled = pool->acquire(formatted.size());
+    }
+    if (record_.pooled.empty()) {
+        record_.spilled.assign(formatted.data(), formatted.size());
+    } else {
+        std::copy(std::begin(formatted),
+                  std::end(formatted),
+                  static_cast<char *>(
+                      static_cast<void *>(record_.pooled.data().data())));
+        record_.size = formatted.size();
+    }
+
+    if (this->m_queue.try_push(record_)) {
+        this->m_not_empty.notify();
+        return write_result::queued;
+    }
+
+    if (this->m_overflow_policy == overflow_policy::drop) {
+        return write_result::dropped;
+    }
+
+    bool pushed = false;
+    this->m_not_full.wait([this, &record_, &pushed]() {
+        pushed = this->m_queue.try_push(record_);
+        return pushed || this->m_failed.load(std::memory_order_acquire);
+    });
+
+    if (!pushed) {
+        return write_result::dropped;
+    }
+
+    this->m_not_empty.notify();
+    return write_result::stalled;
+}
+
+gsl::span<char> sink::record::bytes() noexcept {
+    if (this->pooled.empty()) {
+        return {this->spilled.data(), this->spilled.size()};
+    }
+    return {static_cast<char *>(
+                static_cast<void *>(this->pooled.data().data())),
+            this->size};
+}
+
+void sink::format_record(std::pmr::string &out,
+                         activity activity_,
+                         std::string_view payload) const {
+    out.clear();
+    const std::string_view activity_string = activity_to_string(activity_);
+
+    switch (this->m_format) {
+    case format::text:
+        out.reserve(activity_string.size() + payload.size() + 12);
+        out.append("Received ");
+        out.append(activity_string);
+        out.append(":\n");
+        out.append(payload);
+        out.push_back('\n');
+        break;
+    case format::json_lines:
+        out.reserve(activity_string.size() + payload.size() + 32);
+        out.append("{\"activity\":\"");
+        out.append(activity_string);
+        out.append("\",\"payload\":");
+        append_json_string(out, payload);
+        out.append("}\n");
+        break;
+    }
+}
+
+void sink::write_loop() noexcept {
+    record record_;
+
+    while (true) {
+        this->m_not_empty.wait([this]() {
+            return !this->m_queue.empty() ||
+                   this->m_stopping.load(std::memory_order_acquire);
+        });
+
+        // Checked before draining, so every record queued before the
+        // destructor ran is written
+        const bool stopping =
+            this->m_stopping.load(std::memory_order_acquire);
+
+        while (this->m_writing.size() < this->m_queue.capacity() &&
+               this->m_queue.try_pop(record_)) {
+            this->m_writing.push_back(std::move(record_));
+        }
+        this->m_not_full.notify();
+
+        if (!this->m_writing.empty()) {
+            const bool written = this->write_records();
+
+            if (this->m_abandoned.load(std::memory_order_acquire)) {
+                this->m_discarded = this->m_writing.size();
+                this->m_writing.clear();
+                return;
+            }
+            this->m_writing.clear();
+
+            if (!written) {
+                std::cerr << "Failed to write the output, dropping all "
+                             "further items\n";
+                this->m_failed.store(true, std::memory_order_release);
+                this->m_not_full.notify();
+                return;
+            }
+        }
+
+        if ((stopping && this->m_queue.empty()) ||
+            this->m_abandoned.load(std::memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+bool sink::write_records() noexcept {
+    auto &records = this->m_writing;
+
+#ifdef _WIN32
+    for (auto &record_ : records) {
+        const auto bytes = record_.bytes();
+        std::size_t offset = 0;
+        while (offset < bytes.size()) {
+            const auto chunk = std::min<std::size_t>(bytes.size() - offset,
+                                                     1U << 30U);
+            const int written =
+                _write(this->m_fd,
+                       std::next(bytes.data(),
+                                 static_cast<std::ptrdiff_t>(offset)),
+                       static_cast<unsigned int>(chunk));
+            if (written < 0) {
+                return false;
+            }
+            offset += static_cast<std::size_t>(written);
+        }
+    }
+    return true;
+#else
+    std::array<iovec, max_batch_iovecs> iovecs = {};
+
+    // Position of the first byte not yet written
+    std::size_t record_index = 0;
+    std::size_t record_offset = 0;
+
+    while (record_index < records.size()) {
+        std::size_t iovec_count = 0;
+        for (auto i = record_index;
+             i < records.size() && iovec_count < iovecs.size();
+             ++i, ++iovec_count) {
+            const auto offset = i == record_index ? record_offset : 0;
+            auto &entry = iovecs.at(iovec_count);
+            const auto bytes = records[i].bytes();
+            entry.iov_base = std::next(bytes.data(),
+                                       static_cast<std::ptrdiff_t>(offset));
+            entry.iov_len = bytes.size() - offset;
+        }
+
+        if (this->m_abandoned.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        const auto written =
+            ::writev(this->m_fd, iovecs.data(), static_cast<int>(iovec_count));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN && this->wait_writable()) {
+                continue;
+            }
+            return false;
+        }
+
+        // Skip over everything the kernel took, a write may end mid-record
+        auto remaining = static_cast<std::size_t>(written);
+        while (record_index < records.size() &&
+               remaining >=
+                   records[record_index].bytes().size() - record_offset) {
+            remaining -= records[record_index].bytes().size() - record_offset;
+            ++record_index;
+            record_offset = 0;
+        }
+        record_offset += remaining;
+    }
+    return true;
+#endif
+}
+
+#ifndef _WIN32
+bool sink::wait_writable() noexcept {
+    std::array<pollfd, 2> fds = {
+        {{this->m_fd, POLLOUT, 0}, {this->m_wake_read_fd, POLLIN, 0}}};
+
+    while (::poll(fds.data(), fds.size(), -1) == -1) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    // An error or hangup on the output is left for the next write to report
+    return fds[1].revents == 0;
+}
+#endif
+
+} // namespace linkollector
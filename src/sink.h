@@ -0,0 +1,130 @@
+#pragma once
+
+#include "activity.h"
+#include "buffer_pool.h"
+#include "ring_buffer.h"
+
+#include <gsl/span>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace linkollector {
+
+// Output of received items. Workers format records and push them onto a
+// lock-free ring; a writer thread drains it and hands each batch of records
+// to the kernel in as few writev calls as possible. The ring holds at least
+// capacity records, after which writers wait or drop the record as the
+// overflow policy says, so a slow consumer shows up as stalled or dropped
+// writes rather than a stalled receive loop.
+class sink final {
+
+public:
+    enum class format {
+        // "Received URL:\n<payload>\n"
+        text,
+        // {"activity":"URL","payload":"<payload>"}
+        json_lines
+    };
+
+    enum class target { standard_output, file, named_pipe };
+
+    enum class write_result { queued, stalled, dropped };
+
+    explicit sink(format format_,
+                  std::size_t capacity,
+                  wait_strategy wait_strategy_ = wait_strategy::block,
+                  overflow_policy overflow_policy_ =
+                      overflow_policy::wait) noexcept;
+    sink(const sink &other) = delete;
+    sink &operator=(const sink &other) = delete;
+    sink(sink &&other) noexcept = delete;
+    sink &operator=(sink &&other) noexcept = delete;
+
+    // Writes out all queued records before returning.
+    ~sink() noexcept;
+
+    // Opens the target and starts the writer thread. Files are appended
+    // to, named pipes are created if needed and block until a reader
+    // connects. path is ignored for the standard output.
+    [[nodiscard]] bool open(target target_, const std::string &path) noexcept;
+
+    // Queues an item. A full ring makes the call wait for the writer
+    // (stalled) or discard the item (dropped), depending on the overflow
+    // policy. Items are always dropped once the output failed.
+    //
+    // The record is formatted in arena, scratch memory the calling thread
+    // may reset once the call returns, and then kept in a buffer from
+    // pool, owned by the calling thread. It only spills to the heap when
+    // it does not fit or the pool is exhausted.
+    write_result write(activity activity_,
+                       std::string_view payload,
+                       buffer_pool *pool = nullptr,
+                       std::pmr::memory_resource *arena = nullptr) noexcept;
+
+    // Lets the writer thread exit once it has written every queued record,
+    // which finished() then reports. For a shutdown with a deadline; the
+    // destructor otherwise waits for the writer as long as it takes.
+    void finish() noexcept;
+    [[nodiscard]] bool finished() const noexcept;
+
+    // Gives up on the output: further items are dropped, writers waiting
+    // for room are released and the writer thread is woken and joined. A
+    // write to a regular file already in progress is waited for. Returns
+    // how many queued records were never written.
+    std::uint64_t abandon() noexcept;
+
+private:
+    struct record final {
+        buffer_pool::buffer pooled;
+        std::size_t size = 0;
+        std::string spilled;
+
+        [[nodiscard]] gsl::span<char> bytes() noexcept;
+    };
+
+    void format_record(std::pmr::string &out,
+                       activity activity_,
+                       std::string_view payload) const;
+    void write_loop() noexcept;
+    [[nodiscard]] bool write_records() noexcept;
+#ifndef _WIN32
+    // Waits until the output takes more data. Fails if abandon() gave up
+    // on it meanwhile.
+    [[nodiscard]] bool wait_writable() noexcept;
+#endif
+
+    format m_format;
+    overflow_policy m_overflow_policy;
+    int m_fd = -1;
+    bool m_owns_fd = false;
+#ifndef _WIN32
+    // Flags of the output before it was made non-blocking, or -1
+    int m_original_flags = -1;
+    int m_wake_read_fd = -1;
+    int m_wake_write_fd = -1;
+#endif
+
+    mpsc_ring<record> m_queue;
+    wait_point m_not_empty;
+    wait_point m_not_full;
+    std::atomic<bool> m_stopping = false;
+    std::atomic<bool> m_failed = false;
+    std::atomic<bool> m_abandoned = false;
+    std::atomic<bool> m_finished = false;
+    // Records the writer was holding when it was abandoned
+    std::uint64_t m_discarded = 0;
+
+    // Owned by the writer thread once open() returns
+    std::vector<record> m_writing;
+
+    std::thread m_writer;
+};
+
+} // namespace linkollector
@@ -0,0 +1,443 @@
+#include "store.h"
+
+#include "hash.h"
+#include "mapped_file.h"
+#include "protocol.h"
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace linkollector {
+
+constexpr std::size_t size_field_size = sizeof(std::uint32_t);
+constexpr std::size_t checksum_field_size = sizeof(std::uint32_t);
+constexpr std::size_t sequence_offset = 0;
+constexpr std::size_t timestamp_offset = sizeof(std::uint64_t);
+constexpr std::size_t activity_offset = 2 * sizeof(std::uint64_t);
+constexpr std::size_t payload_offset = activity_offset + 1;
+constexpr std::size_t record_header_size =
+    size_field_size + checksum_field_size;
+
+// Appends wait for the flusher beyond this many pending bytes
+constexpr std::size_t max_pending_bytes = 64U * 1024U * 1024U;
+
+template <typename Integer>
+static void write_le(std::byte *destination, Integer value) noexcept {
+    for (std::size_t i = 0; i < sizeof(Integer); ++i) {
+        *std::next(destination, static_cast<std::ptrdiff_t>(i)) =
+            static_cast<std::byte>(value & 0xffU);
+        value = static_cast<Integer>(value >> 8U);
+    }
+}
+
+template <typename Integer>
+[[nodiscard]] static Integer read_le(gsl::span<const std::byte> source,
+                                     std::size_t offset) noexcept {
+    Integer value = 0;
+    for (std::size_t i = sizeof(Integer); i > 0; --i) {
+        value = static_cast<Integer>(
+            (value << 8U) | std::to_integer<Integer>(source[offset + i - 1]));
+    }
+    return value;
+}
+
+[[nodiscard]] static std::string segment_path(const std::string &directory,
+                                              std::uint32_t index) {
+    auto name = std::to_string(index);
+    name.insert(0, 8 - std::min<std::size_t>(name.size(), 8), '0');
+    return directory + "/" + name + ".log";
+}
+
+// Walks the valid records at the start of a segment, calling callback (if
+// given) for each. Returns the number of bytes they span.
+[[nodiscard]] static std::size_t
+parse_segment(gsl::span<const std::byte> segment,
+              void *data,
+              void (*callback)(void *, const store::record &)) noexcept {
+    std::size_t offset = 0;
+
+    while (segment.size() - offset >= record_header_size) {
+        const auto body_size = read_le<std::uint32_t>(segment, offset);
+        const auto checksum =
+            read_le<std::uint32_t>(segment, offset + size_field_size);
+
+        if (body_size < payload_offset ||
+            body_size > segment.size() - offset - record_header_size) {
+            break;
+        }
+
+        const auto body =
+            segment.subspan(offset + record_header_size, body_size);
+        const auto crc = crc32_update(
+            crc32_update(0, body.subspan(activity_offset)),
+            body.subspan(sequence_offset, activity_offset));
+
+        const auto maybe_activity =
+            protocol::v2::from_activity_code(body[activity_offset]);
+
+        if (crc != checksum || !maybe_activity.has_value()) {
+            break;
+        }
+
+        if (callback != nullptr) {
+            const auto payload = body.subspan(payload_offset);
+            const auto *const payload_data = static_cast<const char *>(
+                static_cast<const void *>(payload.data()));
+            const store::record record_{
+                read_le<std::uint64_t>(body, sequence_offset),
+                read_le<std::uint64_t>(body, timestamp_offset),
+                *maybe_activity,
+                std::string_view(payload_data, payload.size())};
+            callback(data, record_);
+        }
+
+        offset += record_header_size + body_size;
+    }
+
+    return offset;
+}
+
+store::store(std::string directory,
+             std::uint64_t segment_size,
+             std::chrono::milliseconds fsync_interval) noexcept
+    : m_directory(std::move(directory)), m_segment_size(segment_size),
+      m_fsync_interval(fsync_interval) {}
+
+store::~store() noexcept {
+    if (this->m_flusher.joinable()) {
+        this->finish();
+        this->m_flusher.join();
+    }
+
+    this->close_segment();
+}
+
+bool store::open() noexcept {
+#ifdef _WIN32
+    const int mkdir_rc = _mkdir(this->m_directory.c_str());
+#else
+    const int mkdir_rc = ::mkdir(this->m_directory.c_str(), 0755);
+#endif
+    if (mkdir_rc == -1 && errno != EEXIST) {
+        return false;
+    }
+
+    std::uint32_t segment_count = 0;
+    while (mapped_file(segment_path(this->m_directory, segment_count))
+               .is_open()) {
+        ++segment_count;
+    }
+
+    std::uint32_t append_index = 0;
+    std::uint64_t append_bytes = 0;
+
+    if (segment_count > 0) {
+        const auto last_index = segment_count - 1;
+        const mapped_file last(segment_path(this->m_directory, last_index));
+        const auto valid_bytes = parse_segment(last.data(), nullptr, nullptr);
+
+        // Never append behind a torn or corrupt tail, readers would stop
+        // before reaching the new records
+        if (valid_bytes == last.data().size()) {
+            append_index = last_index;
+            append_bytes = valid_bytes;
+        } else {
+            append_index = segment_count;
+        }
+
+        // Continue the sequence after the newest segment holding a record
+        for (auto index = segment_count; index > 0; --index) {
+            const mapped_file segment(
+                segment_path(this->m_directory, index - 1));
+            std::optional<std::uint64_t> last_sequence;
+            [[maybe_unused]] const auto parsed = parse_segment(
+                segment.data(),
+                static_cast<void *>(&last_sequence),
+                [](void *last_sequence_, const record &record_) {
+                    *static_cast<std::optional<std::uint64_t> *>(
+                        last_sequence_) = record_.sequence;
+                });
+            if (last_sequence.has_value()) {
+                this->m_next_sequence = *last_sequence + 1;
+                break;
+            }
+        }
+    }
+
+    if (!this->open_segment(append_index, append_bytes)) {
+        return false;
+    }
+
+    this->m_synced_sequence = this->m_next_sequence;
+
+    this->m_flusher = std::thread([this]() noexcept {
+        this->flush_loop();
+        this->m_finished.store(true, std::memory_order_release);
+    });
+    return true;
+}
+
+void store::finish() noexcept {
+    {
+        const std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_stopping = true;
+    }
+    this->m_flush_condition.notify_one();
+}
+
+bool store::finished() const noexcept {
+    return !this->m_flusher.joinable() ||
+           this->m_finished.load(std::memory_order_acquire);
+}
+
+std::uint64_t store::abandon() noexcept {
+    if (!this->m_flusher.joinable()) {
+        return 0;
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_stopping = true;
+        this->m_abandoned = true;
+    }
+    this->m_flush_condition.notify_one();
+    this->m_synced_condition.notify_all();
+    this->m_room_condition.notify_all();
+    this->m_flusher.join();
+    return this->m_discarded;
+}
+
+std::optional<std::uint64_t>
+store::append(activity activity_, std::string_view payload) noexcept {
+    const auto body_size = payload_offset + payload.size();
+    if (body_size > std::numeric_limits<std::uint32_t>::max()) {
+        std::cerr << "Item of " << payload.size()
+                  << " bytes is too large for the link store\n";
+        return std::nullopt;
+    }
+    const auto record_size = record_header_size + body_size;
+
+    const auto activity_code =
+        static_cast<std::byte>(protocol::v2::to_activity_code(activity_));
+
+    const auto payload_crc = crc32_update(
+        crc32_update(0, {&activity_code, 1}),
+        {static_cast<const std::byte *>(
+             static_cast<const void *>(payload.data())),
+         payload.size()});
+
+    const auto timestamp_us = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+
+    // A record larger than the limit is let through once nothing else is
+    // pending
+    const auto has_room = [this, record_size]() {
+        return this->m_pending.empty() ||
+               this->m_pending.size() + record_size <= max_pending_bytes ||
+               this->m_abandoned;
+    };
+    if (!has_room()) {
+        ++this->m_flush_waiters;
+        this->m_flush_condition.notify_one();
+        this->m_room_condition.wait(lock, has_room);
+        --this->m_flush_waiters;
+    }
+
+    if (this->m_abandoned) {
+        return std::nullopt;
+    }
+
+    const auto record_offset = this->m_pending.size();
+    this->m_pending.resize(record_offset + record_size);
+    auto *const record_begin = std::next(
+        this->m_pending.data(), static_cast<std::ptrdiff_t>(record_offset));
+    auto *const body = std::next(
+        record_begin, static_cast<std::ptrdiff_t>(record_header_size));
+
+    const auto sequence = this->m_next_sequence++;
+    write_le(std::next(body, sequence_offset), sequence);
+    write_le(std::next(body, timestamp_offset), timestamp_us);
+    *std::next(body, activity_offset) = activity_code;
+    std::memcpy(std::next(body, payload_offset),
+                payload.data(),
+                payload.size());
+
+    const auto checksum = crc32_update(
+        payload_crc, {std::next(body, sequence_offset), activity_offset});
+
+    write_le(record_begin, static_cast<std::uint32_t>(body_size));
+    write_le(std::next(record_begin, size_field_size), checksum);
+    return {sequence};
+}
+
+bool store::wait_synced(std::uint64_t sequence) noexcept {
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+
+    ++this->m_flush_waiters;
+    this->m_flush_condition.notify_one();
+    this->m_synced_condition.wait(lock, [this, sequence]() {
+        return this->m_synced_sequence > sequence || this->m_write_failed ||
+               this->m_abandoned;
+    });
+    --this->m_flush_waiters;
+
+    return this->m_synced_sequence > sequence && !this->m_write_failed;
+}
+
+bool store::for_each_record(
+    const std::string &directory,
+    void *data,
+    void (*callback)(void *, const record &)) noexcept {
+    std::uint32_t index = 0;
+
+    while (true) {
+        const mapped_file segment(segment_path(directory, index));
+        if (!segment.is_open()) {
+            return index > 0;
+        }
+
+        [[maybe_unused]] const auto parsed =
+            parse_segment(segment.data(), data, callback);
+        ++index;
+    }
+}
+
+void store::flush_loop() noexcept {
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+
+    while (true) {
+        this->m_flush_condition.wait_for(
+            lock, this->m_fsync_interval, [this]() {
+                return this->m_stopping ||
+                       (this->m_flush_waiters > 0 && !this->m_pending.empty());
+            });
+
+        const bool stopping = this->m_stopping;
+
+        if (this->m_abandoned) {
+            const gsl::span<const std::byte> pending(this->m_pending);
+            for (std::size_t offset = 0; offset < pending.size();
+                 offset += record_header_size +
+                           read_le<std::uint32_t>(pending, offset)) {
+                ++this->m_discarded;
+            }
+            this->m_pending.clear();
+            break;
+        }
+
+        std::swap(this->m_pending, this->m_writing);
+        const auto writing_end = this->m_next_sequence;
+        this->m_room_condition.notify_all();
+        lock.unlock();
+
+        bool written = true;
+        if (!this->m_writing.empty()) {
+            written = this->write_records(this->m_writing);
+            if (!written) {
+                std::cerr << "Failed to write to the link store\n";
+            }
+            this->m_writing.clear();
+        }
+
+        lock.lock();
+        this->m_synced_sequence = writing_end;
+        this->m_write_failed = this->m_write_failed || !written;
+        this->m_synced_condition.notify_all();
+
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+bool store::write_records(const std::vector<std::byte> &records) noexcept {
+    const gsl::span<const std::byte> all(records);
+    std::size_t run_begin = 0;
+    std::size_t offset = 0;
+
+    const auto write_run = [this, &all](std::size_t begin, std::size_t end) {
+        if (begin == end) {
+            return true;
+        }
+        const auto run = all.subspan(begin, end - begin);
+        this->m_segment_bytes += run.size();
+        return std::fwrite(run.data(), 1, run.size(), this->m_segment) ==
+               run.size();
+    };
+
+    while (offset < all.size()) {
+        const auto record_size =
+            record_header_size + read_le<std::uint32_t>(all, offset);
+        const auto segment_bytes =
+            this->m_segment_bytes + (offset - run_begin);
+
+        if (segment_bytes > 0 &&
+            segment_bytes + record_size > this->m_segment_size) {
+            if (!write_run(run_begin, offset) || !this->sync_segment() ||
+                !this->open_segment(this->m_segment_index + 1, 0)) {
+                return false;
+            }
+            run_begin = offset;
+        }
+
+        offset += record_size;
+    }
+
+    return write_run(run_begin, offset) && this->sync_segment();
+}
+
+bool store::open_segment(std::uint32_t index,
+                         std::uint64_t existing_bytes) noexcept {
+    this->close_segment();
+
+    this->m_segment =
+        std::fopen(segment_path(this->m_directory, index).c_str(), "ab");
+    if (this->m_segment == nullptr) {
+        return false;
+    }
+
+    this->m_segment_index = index;
+    this->m_segment_bytes = existing_bytes;
+    return true;
+}
+
+bool store::sync_segment() noexcept {
+    if (std::fflush(this->m_segment) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(this->m_segment)) == 0;
+#else
+    return ::fsync(::fileno(this->m_segment)) == 0;
+#endif
+}
+
+void store::close_segment() noexcept {
+    if (this->m_segment != nullptr) {
+        std::fclose(this->m_segment);
+        this->m_segment = nullptr;
+    }
+}
+
+} // namespace linkollector
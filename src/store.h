@@ -0,0 +1,127 @@
+#pragma once
+
+#include "activity.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace linkollector {
+
+// Append-only log of received items, split into numbered segment files
+// inside one directory. Each record is stored as
+//
+//   u32 body size, u32 checksum,
+//   body: u64 sequence, u64 timestamp (us since epoch), u8 activity code,
+//         payload
+//
+// with integers little-endian. The checksum is the CRC-32 of the activity
+// code and payload followed by the sequence and timestamp, so the bulk of
+// it can be computed before the sequence is assigned.
+//
+// Appends are buffered in memory and written by a flusher thread, which
+// syncs once per fsync interval for all records appended since the last
+// flush, or right away while someone waits for a record to be synced or
+// for room: appends wait once the records pending in memory reach a limit.
+class store final {
+
+public:
+    struct record final {
+        std::uint64_t sequence;
+        std::uint64_t timestamp_us;
+        activity record_activity;
+        std::string_view payload;
+    };
+
+    explicit store(std::string directory,
+                   std::uint64_t segment_size,
+                   std::chrono::milliseconds fsync_interval) noexcept;
+    store(const store &other) = delete;
+    store &operator=(const store &other) = delete;
+    store(store &&other) noexcept = delete;
+    store &operator=(store &&other) noexcept = delete;
+    ~store() noexcept;
+
+    // Creates the directory if needed and starts the flusher thread.
+    [[nodiscard]] bool open() noexcept;
+
+    // Queues a record for the next flush and returns its sequence number.
+    // Waits while too much is pending. Fails for records too large for the
+    // record format, and once the store was abandoned.
+    [[nodiscard]] std::optional<std::uint64_t>
+    append(activity activity_, std::string_view payload) noexcept;
+
+    // Waits until the record with this sequence number is on disk. Records
+    // of concurrent waiters share one sync. Fails once a write to the
+    // store failed, or if the store was abandoned.
+    [[nodiscard]] bool wait_synced(std::uint64_t sequence) noexcept;
+
+    // Lets the flusher thread exit once it has written and synced every
+    // appended record, which finished() then reports. For a shutdown with
+    // a deadline; the destructor otherwise waits as long as it takes.
+    void finish() noexcept;
+    [[nodiscard]] bool finished() const noexcept;
+
+    // Stops the flusher without writing the records it has not started
+    // on, and joins it. A write already under way cannot be interrupted
+    // and is waited for. Returns how many records were discarded.
+    std::uint64_t abandon() noexcept;
+
+    // Maps every segment in directory and calls callback for each valid
+    // record, in order. The record's payload points into the mapping and
+    // is only valid during the call. Iteration of a segment stops at the
+    // first truncated or corrupt record.
+    [[nodiscard]] static bool
+    for_each_record(const std::string &directory,
+                    void *data,
+                    void (*callback)(void *, const record &)) noexcept;
+
+private:
+    void flush_loop() noexcept;
+    [[nodiscard]] bool
+    write_records(const std::vector<std::byte> &records) noexcept;
+    [[nodiscard]] bool open_segment(std::uint32_t index,
+                                    std::uint64_t existing_bytes) noexcept;
+    [[nodiscard]] bool sync_segment() noexcept;
+    void close_segment() noexcept;
+
+    std::string m_directory;
+    std::uint64_t m_segment_size;
+    std::chrono::milliseconds m_fsync_interval;
+
+    std::mutex m_mutex;
+    std::condition_variable m_flush_condition;
+    std::condition_variable m_synced_condition;
+    std::condition_variable m_room_condition;
+    std::vector<std::byte> m_pending;
+    std::uint64_t m_next_sequence = 0;
+    // Records before this sequence number were written and synced, or
+    // lost to a failed write
+    std::uint64_t m_synced_sequence = 0;
+    // Threads waiting for the flusher, which then flushes right away
+    unsigned int m_flush_waiters = 0;
+    bool m_write_failed = false;
+    bool m_stopping = false;
+    bool m_abandoned = false;
+    std::uint64_t m_discarded = 0;
+    std::atomic<bool> m_finished = false;
+
+    // Owned by the flusher thread once open() returns
+    std::vector<std::byte> m_writing;
+    std::FILE *m_segment = nullptr;
+    std::uint32_t m_segment_index = 0;
+    std::uint64_t m_segment_bytes = 0;
+
+    std::thread m_flusher;
+};
+
+} // namespace linkollector
@@ -0,0 +1,246 @@
+#include "stream_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace linkollector {
+
+static void close_fd(int fd) noexcept {
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+[[nodiscard]] static bool
+write_at(int fd, std::uint64_t offset, std::string_view data) noexcept {
+    while (!data.empty()) {
+#ifdef _WIN32
+        if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) == -1) {
+            return false;
+        }
+        const auto written =
+            _write(fd,
+                   data.data(),
+                   static_cast<unsigned int>(
+                       std::min<std::size_t>(data.size(), 1U << 30U)));
+#else
+        const auto written =
+            ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+        offset += static_cast<std::uint64_t>(written);
+    }
+    return true;
+}
+
+// Holes a stream may have at once. Chunks in flight leave at most one
+// each, a sender that scatters chunks further is refused.
+constexpr std::size_t max_covered_ranges = 4096;
+
+using covered_ranges = std::map<std::uint64_t, std::uint64_t>;
+
+[[nodiscard]] static bool is_covered(const covered_ranges &covered,
+                                     std::uint64_t begin,
+                                     std::uint64_t end) noexcept {
+    auto it = covered.upper_bound(begin);
+    if (it == covered.begin()) {
+        return begin == end;
+    }
+    return std::prev(it)->second >= end;
+}
+
+// Adds [begin, end) to the ranges, merging the ones it overlaps or
+// touches. Returns how many of its bytes were not covered before.
+[[nodiscard]] static std::uint64_t
+cover(covered_ranges &covered, std::uint64_t begin, std::uint64_t end) {
+    std::uint64_t added = end - begin;
+    auto merged_begin = begin;
+    auto merged_end = end;
+
+    auto it = covered.upper_bound(begin);
+    if (it != covered.begin() && std::prev(it)->second >= begin) {
+        --it;
+    }
+
+    while (it != covered.end() && it->first <= end) {
+        const auto overlap_begin = std::max(it->first, begin);
+        const auto overlap_end = std::min(it->second, end);
+        if (overlap_end > overlap_begin) {
+            added -= overlap_end - overlap_begin;
+        }
+        merged_begin = std::min(merged_begin, it->first);
+        merged_end = std::max(merged_end, it->second);
+        it = covered.erase(it);
+    }
+
+    covered.emplace(merged_begin, merged_end);
+    return added;
+}
+
+stream_writer::stream_writer(std::string directory) noexcept
+    : m_directory(std::move(directory)) {}
+
+stream_writer::~stream_writer() noexcept {
+    for (const auto &[stream_id, stream_] : this->m_streams) {
+        close_fd(stream_.fd);
+    }
+}
+
+bool stream_writer::open() noexcept {
+#ifdef _WIN32
+    const int mkdir_rc = _mkdir(this->m_directory.c_str());
+#else
+    const int mkdir_rc = ::mkdir(this->m_directory.c_str(), 0755);
+#endif
+    return mkdir_rc == 0 || errno == EEXIST;
+}
+
+stream_writer::result stream_writer::write(const protocol::v2::chunk &chunk_,
+                                           std::string_view data,
+                                           std::string &path) noexcept {
+    const auto begin = chunk_.offset;
+    const auto end = chunk_.offset + data.size();
+    int fd = -1;
+    bool written = false;
+
+    {
+        const std::lock_guard<std::mutex> lock(this->m_mutex);
+
+        auto it = this->m_streams.find(chunk_.stream_id);
+        if (it == this->m_streams.end()) {
+            const auto part_path = this->path_for(chunk_.stream_id) + ".part";
+#ifdef _WIN32
+            fd = _open(part_path.c_str(),
+                       _O_WRONLY | _O_CREAT | _O_BINARY,
+                       _S_IREAD | _S_IWRITE);
+#else
+            fd = ::open(part_path.c_str(), O_WRONLY | O_CREAT, 0644);
+#endif
+            if (fd == -1) {
+                return result::failed;
+            }
+            stream stream_;
+            stream_.fd = fd;
+            stream_.total_size = chunk_.total_size;
+            it = this->m_streams.emplace(chunk_.stream_id, std::move(stream_))
+                     .first;
+        }
+
+        auto &stream_ = it->second;
+        stream_.last_activity = clock::now();
+
+        if (stream_.total_size != chunk_.total_size) {
+            return result::failed;
+        }
+
+        // A chunk sent again was written before, acknowledge it only
+        if (is_covered(stream_.covered, begin, end)) {
+            return result::accepted;
+        }
+
+        if (stream_.covered.size() >= max_covered_ranges) {
+            return result::failed;
+        }
+
+        fd = stream_.fd;
+        ++stream_.writers;
+
+#ifdef _WIN32
+        // Without pwrite the seek and write must not interleave
+        written = write_at(fd, begin, data);
+#endif
+    }
+
+#ifndef _WIN32
+    // The descriptor stays open while any thread is still writing to it
+    written = write_at(fd, begin, data);
+#endif
+
+    const std::lock_guard<std::mutex> lock(this->m_mutex);
+
+    auto &stream_ = this->m_streams.find(chunk_.stream_id)->second;
+    --stream_.writers;
+
+    // Only bytes on disk count, so a resend of a failed chunk is written
+    if (written) {
+        stream_.received += cover(stream_.covered, begin, end);
+    }
+
+    if (stream_.received == stream_.total_size && stream_.writers == 0) {
+        return this->complete(chunk_.stream_id, path);
+    }
+    return written ? result::accepted : result::failed;
+}
+
+std::size_t stream_writer::expire(
+    std::chrono::steady_clock::duration idle_timeout) noexcept {
+    const std::lock_guard<std::mutex> lock(this->m_mutex);
+    const auto now = clock::now();
+    std::size_t expired = 0;
+
+    for (auto it = this->m_streams.begin(); it != this->m_streams.end();) {
+        const auto &stream_ = it->second;
+        if (stream_.writers > 0 ||
+            now - stream_.last_activity < idle_timeout) {
+            ++it;
+            continue;
+        }
+
+        close_fd(stream_.fd);
+        const auto part_path = this->path_for(it->first) + ".part";
+        std::remove(part_path.c_str());
+        it = this->m_streams.erase(it);
+        ++expired;
+    }
+    return expired;
+}
+
+stream_writer::result stream_writer::complete(std::uint64_t stream_id,
+                                              std::string &path) noexcept {
+    const auto it = this->m_streams.find(stream_id);
+    close_fd(it->second.fd);
+    this->m_streams.erase(it);
+
+    path = this->path_for(stream_id);
+    const auto part_path = path + ".part";
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    return std::rename(part_path.c_str(), path.c_str()) == 0
+               ? result::completed
+               : result::failed;
+}
+
+std::string stream_writer::path_for(std::uint64_t stream_id) const {
+    std::array<char, 17> name = {};
+    std::snprintf(name.data(),
+                  name.size(),
+                  "%016llx",
+                  static_cast<unsigned long long>(stream_id));
+    return this->m_directory + "/" + name.data();
+}
+
+} // namespace linkollector
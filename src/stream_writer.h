@@ -0,0 +1,83 @@
+#pragma once
+
+#include "protocol.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace linkollector {
+
+// Reassembles chunked items into files inside one directory. Each chunk is
+// written at its offset as soon as it arrives, so memory use does not
+// depend on the item size and chunks may be written by several threads in
+// any order. An item is written to "<stream id>.part" and renamed to
+// "<stream id>" once all of its bytes have arrived.
+//
+// Bytes are only counted once written, whatever the chunks' boundaries, so
+// overlapping chunks cannot complete an item that still has holes. The
+// bookkeeping is a set of covered ranges, which stays small as long as
+// chunks arrive roughly in order, and is capped. Streams nobody writes to
+// any more are dropped with expire().
+class stream_writer final {
+
+public:
+    explicit stream_writer(std::string directory) noexcept;
+    stream_writer(const stream_writer &other) = delete;
+    stream_writer &operator=(const stream_writer &other) = delete;
+    stream_writer(stream_writer &&other) noexcept = delete;
+    stream_writer &operator=(stream_writer &&other) noexcept = delete;
+
+    // Closes the files of incomplete streams, leaving them as .part files.
+    ~stream_writer() noexcept;
+
+    // Creates the directory if needed.
+    [[nodiscard]] bool open() noexcept;
+
+    enum class result { failed, accepted, completed };
+
+    // On completion, path is set to the finished file.
+    [[nodiscard]] result write(const protocol::v2::chunk &chunk_,
+                               std::string_view data,
+                               std::string &path) noexcept;
+
+    // Closes and deletes the .part files of streams that received no
+    // chunk for idle_timeout. Returns how many were dropped.
+    std::size_t
+    expire(std::chrono::steady_clock::duration idle_timeout) noexcept;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct stream final {
+        int fd;
+        std::uint64_t total_size;
+        // Bytes written so far, as [begin, end) ranges keyed by begin
+        std::map<std::uint64_t, std::uint64_t> covered;
+        std::uint64_t received = 0;
+        // Threads writing chunks of the stream, the last of which
+        // completes it
+        unsigned int writers = 0;
+        clock::time_point last_activity;
+    };
+
+    // Closes the file and renames it into place. Lock holder only, the
+    // stream is removed.
+    [[nodiscard]] result complete(std::uint64_t stream_id,
+                                  std::string &path) noexcept;
+
+    [[nodiscard]] std::string path_for(std::uint64_t stream_id) const;
+
+    std::string m_directory;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::uint64_t, stream> m_streams;
+};
+
+} // namespace linkollector
@@ -0,0 +1,147 @@
+#include "tracer.h"
+
+#include <chrono>
+#include <iomanip>
+#include <utility>
+
+namespace linkollector {
+
+[[nodiscard]] static const char *span_name(tracer::span kind) noexcept {
+    switch (kind) {
+    case tracer::span::transit: {
+        return "transit";
+    }
+    case tracer::span::receive: {
+        return "receive";
+    }
+    case tracer::span::deserialize: {
+        return "deserialize";
+    }
+    case tracer::span::ack: {
+        return "ack";
+    }
+    case tracer::span::process: {
+        return "process";
+    }
+    case tracer::span::sink_write: {
+        return "sink_write";
+    }
+    case tracer::span::publish: {
+        return "publish";
+    }
+    }
+    return "unknown";
+}
+
+// Microseconds, the unit of trace_event timestamps, to the nanosecond
+static void write_microseconds(std::ofstream &out, std::uint64_t ns) {
+    out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000
+        << std::setfill(' ');
+}
+
+tracer::worker_events::worker_events(std::size_t capacity) noexcept
+    : ring(capacity) {}
+
+tracer::tracer(std::string path,
+               unsigned int worker_count,
+               std::size_t capacity) noexcept
+    : m_path(std::move(path)) {
+    this->m_workers.reserve(worker_count);
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        this->m_workers.push_back(std::make_unique<worker_events>(capacity));
+    }
+}
+
+tracer::~tracer() noexcept {
+    if (!this->m_file.is_open()) {
+        return;
+    }
+
+    [[maybe_unused]] const bool flushed = this->flush();
+    this->m_file << "\n]\n";
+}
+
+std::uint64_t tracer::now() noexcept {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+}
+
+bool tracer::open() noexcept {
+    this->m_file.open(this->m_path, std::ios::trunc);
+    if (!this->m_file) {
+        return false;
+    }
+
+    // Events after the first are preceded by their separator, so the file
+    // is valid up to its last complete event
+    this->m_file << "[";
+    for (std::size_t i = 0; i < this->m_workers.size(); ++i) {
+        this->m_file << (i == 0 ? "\n" : ",\n")
+                     << R"({"name":"thread_name","ph":"M","pid":1,"tid":)"
+                     << i + 1 << R"(,"args":{"name":"worker )" << i
+                     << "\"}}";
+    }
+    return static_cast<bool>(this->m_file.flush());
+}
+
+void tracer::record(unsigned int worker, event &event_) noexcept {
+    auto &events = *this->m_workers[worker];
+    if (!events.ring.try_push(event_)) {
+        events.dropped.store(
+            events.dropped.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    }
+}
+
+bool tracer::flush() noexcept {
+    event event_{};
+    for (std::size_t i = 0; i < this->m_workers.size(); ++i) {
+        while (this->m_workers[i]->ring.try_pop(event_)) {
+            this->write_event(static_cast<unsigned int>(i), event_);
+        }
+    }
+    return static_cast<bool>(this->m_file.flush());
+}
+
+std::uint64_t tracer::dropped() const noexcept {
+    std::uint64_t total = 0;
+    for (const auto &events : this->m_workers) {
+        total += events->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void tracer::write_event(unsigned int worker, const event &event_) {
+    auto &out = this->m_file;
+    const auto tid = worker + 1;
+
+    // Requests overlap in transit, so it is an async span keyed by trace
+    // id rather than a slice on the worker's track
+    if (event_.kind == span::transit) {
+        for (const char phase : {'b', 'e'}) {
+            out << ",\n" << R"({"name":"transit","cat":"linkollector","ph":")"
+                << phase << R"(","id":")" << std::hex << event_.trace_id
+                << std::dec << R"(","pid":1,"tid":)" << tid << R"(,"ts":)";
+            write_microseconds(out,
+                               phase == 'b' ? event_.start_ns : event_.end_ns);
+            out << "}";
+        }
+        return;
+    }
+
+    const auto duration =
+        event_.end_ns > event_.start_ns ? event_.end_ns - event_.start_ns : 0;
+
+    out << ",\n" << R"({"name":")" << span_name(event_.kind)
+        << R"(","cat":"linkollector","ph":"X","pid":1,"tid":)" << tid
+        << R"(,"ts":)";
+    write_microseconds(out, event_.start_ns);
+    out << R"(,"dur":)";
+    write_microseconds(out, duration);
+    out << R"(,"args":{"trace_id":")" << std::hex << event_.trace_id
+        << std::dec << "\"}}";
+}
+
+} // namespace linkollector
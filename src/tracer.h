@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ring_buffer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace linkollector {
+
+// Spans of traced requests, written out as Chrome trace_event JSON that
+// Perfetto and chrome://tracing open. Each worker records into its own
+// single-producer ring, which the owning thread drains into the file; a
+// full ring drops spans rather than slow the worker down.
+//
+// The file uses the array form of the format, whose closing bracket is
+// optional, so a trace cut short by a crash still opens.
+class tracer final {
+
+public:
+    enum class span : std::uint8_t {
+        // From the sender's send time to the worker picking the request up
+        transit,
+        receive,
+        deserialize,
+        ack,
+        process,
+        sink_write,
+        publish,
+    };
+
+    struct event final {
+        span kind;
+        std::uint64_t trace_id;
+        std::uint64_t start_ns;
+        std::uint64_t end_ns;
+    };
+
+    explicit tracer(std::string path,
+                    unsigned int worker_count,
+                    std::size_t capacity) noexcept;
+    tracer(const tracer &other) = delete;
+    tracer &operator=(const tracer &other) = delete;
+    tracer(tracer &&other) noexcept = delete;
+    tracer &operator=(tracer &&other) noexcept = delete;
+
+    // Writes out the remaining spans and closes the trace.
+    ~tracer() noexcept;
+
+    // Nanoseconds since the Unix epoch, the clock senders stamp requests
+    // with
+    [[nodiscard]] static std::uint64_t now() noexcept;
+
+    // Truncates the file and names the worker threads.
+    [[nodiscard]] bool open() noexcept;
+
+    // Worker thread only.
+    void record(unsigned int worker, event &event_) noexcept;
+
+    // Owning thread only. Writes out the spans recorded so far.
+    [[nodiscard]] bool flush() noexcept;
+
+    [[nodiscard]] std::uint64_t dropped() const noexcept;
+
+private:
+    struct alignas(cache_line_size) worker_events final {
+        explicit worker_events(std::size_t capacity) noexcept;
+
+        spsc_ring<event> ring;
+        std::atomic<std::uint64_t> dropped = 0;
+    };
+
+    void write_event(unsigned int worker, const event &event_);
+
+    std::string m_path;
+    std::ofstream m_file;
+    std::vector<std::unique_ptr<worker_events>> m_workers;
+};
+
+} // namespace linkollector
@@ -0,0 +1,364 @@
+#include "url.h"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace linkollector::url {
+
+enum char_class : std::uint8_t {
+    alpha = 1U << 0U,
+    upper_alpha = 1U << 1U,
+    digit = 1U << 2U,
+    hex_digit = 1U << 3U,
+    scheme_char = 1U << 4U,
+    unreserved = 1U << 5U,
+    // Allowed in a host name, besides percent-encodings
+    host_char = 1U << 6U,
+    // Allowed in user info, path and query, besides percent-encodings
+    component_char = 1U << 7U,
+};
+
+constexpr std::array<std::uint8_t, 256> char_classes = []() {
+    std::array<std::uint8_t, 256> table = {};
+
+    const auto add = [&table](std::string_view chars, std::uint8_t flags) {
+        for (const char c : chars) {
+            table.at(static_cast<unsigned char>(c)) |= flags;
+        }
+    };
+
+    const std::uint8_t alphanumeric =
+        scheme_char | unreserved | host_char | component_char;
+    add("abcdefghijklmnopqrstuvwxyz", alphanumeric | alpha);
+    add("ABCDEFGHIJKLMNOPQRSTUVWXYZ", alphanumeric | alpha | upper_alpha);
+    add("0123456789", alphanumeric | digit | hex_digit);
+    add("abcdefABCDEF", hex_digit);
+    add("+-.", scheme_char);
+    add("-._~", unreserved | host_char | component_char);
+    add("!$&'()*+,;=", host_char | component_char);
+    add(":@/?", component_char);
+
+    // Non-ASCII bytes pass through so UTF-8 in paths and queries survives
+    for (std::size_t c = 0x80; c < table.size(); ++c) {
+        table.at(c) |= component_char;
+    }
+
+    return table;
+}();
+
+[[nodiscard]] static bool is(char c, std::uint8_t flags) noexcept {
+    return (char_classes[static_cast<unsigned char>(c)] & flags) != 0;
+}
+
+[[nodiscard]] static char to_lower(char c) noexcept {
+    return is(c, upper_alpha) ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+[[nodiscard]] static unsigned int hex_value(char c) noexcept {
+    if (is(c, digit)) {
+        return static_cast<unsigned int>(c - '0');
+    }
+    return static_cast<unsigned int>(to_lower(c) - 'a' + 10);
+}
+
+// Rewrites a URL in place: characters are read at the read position and
+// written at the write position, which never overtakes it.
+class rewriter final {
+
+public:
+    explicit rewriter(gsl::span<char> url) noexcept
+        : m_data(url.data()), m_size(url.size()) {}
+
+    [[nodiscard]] char *data() const noexcept { return this->m_data; }
+
+    [[nodiscard]] bool at_end() const noexcept {
+        return this->m_read == this->m_size;
+    }
+
+    [[nodiscard]] char peek() const noexcept {
+        return this->m_data[this->m_read];
+    }
+
+    [[nodiscard]] bool at(char c) const noexcept {
+        return !this->at_end() && this->peek() == c;
+    }
+
+    [[nodiscard]] std::size_t read_position() const noexcept {
+        return this->m_read;
+    }
+
+    [[nodiscard]] std::size_t written() const noexcept {
+        return this->m_write;
+    }
+
+    [[nodiscard]] std::string_view input(std::size_t begin) const noexcept {
+        return {this->m_data + begin, this->m_read - begin};
+    }
+
+    [[nodiscard]] std::string_view output(std::size_t begin) const noexcept {
+        return {this->m_data + begin, this->m_write - begin};
+    }
+
+    // Position of the last c before the end of the authority, if any
+    [[nodiscard]] std::optional<std::size_t>
+    find_in_authority(char c) const noexcept {
+        std::optional<std::size_t> found;
+        for (auto i = this->m_read; i < this->m_size; ++i) {
+            const char current = this->m_data[i];
+            if (current == '/' || current == '?' || current == '#') {
+                break;
+            }
+            if (current == c) {
+                found = i;
+            }
+        }
+        return found;
+    }
+
+    void skip() noexcept { ++this->m_read; }
+
+    void put(char c) noexcept { this->m_data[this->m_write++] = c; }
+
+    void copy_lower() noexcept {
+        this->put(to_lower(this->m_data[this->m_read++]));
+    }
+
+    void truncate(std::size_t size) noexcept { this->m_write = size; }
+
+    // Copies one character or percent-encoding, returning false if it is
+    // not allowed.
+    [[nodiscard]] bool copy_encoded(std::uint8_t allowed,
+                                    bool lowercase) noexcept {
+        const char c = this->peek();
+
+        if (c != '%') {
+            if (!is(c, allowed)) {
+                return false;
+            }
+            this->skip();
+            this->put(lowercase ? to_lower(c) : c);
+            return true;
+        }
+
+        if (this->m_size - this->m_read < 3 ||
+            !is(this->m_data[this->m_read + 1], hex_digit) ||
+            !is(this->m_data[this->m_read + 2], hex_digit)) {
+            return false;
+        }
+
+        const auto byte = hex_value(this->m_data[this->m_read + 1]) * 16 +
+                          hex_value(this->m_data[this->m_read + 2]);
+        const auto value = static_cast<char>(byte);
+        this->m_read += 3;
+
+        if (is(value, unreserved)) {
+            this->put(lowercase ? to_lower(value) : value);
+            return true;
+        }
+
+        constexpr std::string_view hex_digits = "0123456789ABCDEF";
+        this->put('%');
+        this->put(hex_digits[byte >> 4U]);
+        this->put(hex_digits[byte & 0xfU]);
+        return true;
+    }
+
+private:
+    // Plain pointer arithmetic keeps the per-character loop free of span
+    // bounds checks
+    char *m_data;
+    std::size_t m_size;
+    std::size_t m_read = 0;
+    std::size_t m_write = 0;
+};
+
+[[nodiscard]] static bool is_default_port(std::string_view scheme,
+                                          std::string_view port) noexcept {
+    return ((scheme == "http" || scheme == "ws") && port == "80") ||
+           ((scheme == "https" || scheme == "wss") && port == "443") ||
+           (scheme == "ftp" && port == "21");
+}
+
+[[nodiscard]] static bool
+is_tracking_parameter(std::string_view key) noexcept {
+    constexpr std::array<std::string_view, 12> tracking_keys = {
+        "fbclid", "gclid",  "dclid", "gbraid",  "wbraid",  "msclkid",
+        "mc_cid", "mc_eid", "yclid", "igshid", "_hsenc", "_hsmi"};
+
+    if (key.substr(0, 4) == "utm_") {
+        return true;
+    }
+    for (const auto tracking_key : tracking_keys) {
+        if (key == tracking_key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Resolves "." and ".." segments (RFC 3986 5.2.4) of the path in
+// data[begin, end), which starts with '/'. Returns the new end.
+[[nodiscard]] static std::size_t
+remove_dot_segments(char *data, std::size_t begin, std::size_t end) noexcept {
+    std::size_t in = begin;
+    std::size_t out = begin;
+
+    while (in < end) {
+        auto segment_end = in + 1;
+        while (segment_end < end && data[segment_end] != '/') {
+            ++segment_end;
+        }
+
+        const std::string_view segment(data + in + 1, segment_end - in - 1);
+
+        if (segment == "." || segment == "..") {
+            if (segment == "..") {
+                while (out > begin && data[out - 1] != '/') {
+                    --out;
+                }
+                if (out > begin) {
+                    --out;
+                }
+            }
+            // A trailing dot segment still names a directory
+            if (segment_end == end) {
+                data[out++] = '/';
+            }
+        } else {
+            for (auto i = in; i < segment_end; ++i) {
+                data[out++] = data[i];
+            }
+        }
+
+        in = segment_end;
+    }
+
+    return out;
+}
+
+std::optional<std::size_t> canonicalize(gsl::span<char> url) noexcept {
+    rewriter rewriter_(url);
+
+    if (rewriter_.at_end() || !is(rewriter_.peek(), alpha)) {
+        return std::nullopt;
+    }
+    while (!rewriter_.at_end() && is(rewriter_.peek(), scheme_char)) {
+        rewriter_.copy_lower();
+    }
+    const auto scheme = rewriter_.output(0);
+
+    for (const char c : std::string_view("://")) {
+        if (!rewriter_.at(c)) {
+            return std::nullopt;
+        }
+        rewriter_.skip();
+        rewriter_.put(c);
+    }
+
+    const auto maybe_user_info_end = rewriter_.find_in_authority('@');
+    if (maybe_user_info_end.has_value()) {
+        while (rewriter_.read_position() < *maybe_user_info_end) {
+            if (!rewriter_.copy_encoded(component_char, false)) {
+                return std::nullopt;
+            }
+        }
+        rewriter_.skip();
+        rewriter_.put('@');
+    }
+
+    const auto host_begin = rewriter_.written();
+    if (rewriter_.at('[')) {
+        rewriter_.skip();
+        rewriter_.put('[');
+        while (!rewriter_.at_end() && rewriter_.peek() != ']') {
+            if (!is(rewriter_.peek(), hex_digit) && !rewriter_.at(':') &&
+                !rewriter_.at('.')) {
+                return std::nullopt;
+            }
+            rewriter_.copy_lower();
+        }
+        if (!rewriter_.at(']')) {
+            return std::nullopt;
+        }
+        rewriter_.skip();
+        rewriter_.put(']');
+    } else {
+        while (!rewriter_.at_end() && !rewriter_.at(':') &&
+               !rewriter_.at('/') && !rewriter_.at('?') &&
+               !rewriter_.at('#')) {
+            if (!rewriter_.copy_encoded(host_char, true)) {
+                return std::nullopt;
+            }
+        }
+    }
+    if (rewriter_.output(host_begin).size() < (rewriter_.at(']') ? 3 : 1)) {
+        return std::nullopt;
+    }
+
+    if (rewriter_.at(':')) {
+        rewriter_.skip();
+        const auto port_begin = rewriter_.read_position();
+        while (!rewriter_.at_end() && is(rewriter_.peek(), digit)) {
+            rewriter_.skip();
+        }
+        const auto port = rewriter_.input(port_begin);
+        if (!port.empty() && !is_default_port(scheme, port)) {
+            rewriter_.put(':');
+            for (const char c : port) {
+                rewriter_.put(c);
+            }
+        }
+    }
+
+    if (!rewriter_.at_end() && !rewriter_.at('/') && !rewriter_.at('?') &&
+        !rewriter_.at('#')) {
+        return std::nullopt;
+    }
+
+    const auto path_begin = rewriter_.written();
+    while (!rewriter_.at_end() && !rewriter_.at('?') && !rewriter_.at('#')) {
+        if (!rewriter_.copy_encoded(component_char, false)) {
+            return std::nullopt;
+        }
+    }
+    rewriter_.truncate(remove_dot_segments(
+        rewriter_.data(), path_begin, rewriter_.written()));
+    if (rewriter_.output(path_begin) == "/") {
+        rewriter_.truncate(path_begin);
+    }
+
+    if (rewriter_.at('?')) {
+        rewriter_.skip();
+        bool first_parameter = true;
+
+        while (!rewriter_.at_end() && !rewriter_.at('#')) {
+            const auto parameter_begin = rewriter_.written();
+            rewriter_.put(first_parameter ? '?' : '&');
+
+            while (!rewriter_.at_end() && !rewriter_.at('&') &&
+                   !rewriter_.at('#')) {
+                if (!rewriter_.copy_encoded(component_char, false)) {
+                    return std::nullopt;
+                }
+            }
+            if (rewriter_.at('&')) {
+                rewriter_.skip();
+            }
+
+            const auto parameter = rewriter_.output(parameter_begin + 1);
+            if (parameter.empty() ||
+                is_tracking_parameter(
+                    parameter.substr(0, parameter.find('=')))) {
+                rewriter_.truncate(parameter_begin);
+            } else {
+                first_parameter = false;
+            }
+        }
+    }
+
+    // The fragment never reaches the server, drop it
+    return rewriter_.written();
+}
+
+} // namespace linkollector::url
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+#include <gsl/span>
+
+namespace linkollector::url {
+
+// Validates an absolute URL ("scheme://authority[/path][?query]") and
+// rewrites it in place into a canonical form, so that equivalent URLs
+// compare equal:
+//
+// - scheme and host are lowercased;
+// - the scheme's default port and an empty port are removed;
+// - percent-encoded unreserved characters are decoded, other
+//   percent-encodings get uppercase hex digits;
+// - "." and ".." path segments are resolved, and a path of just "/" is
+//   removed;
+// - tracking parameters (utm_*, fbclid, gclid, ...) and empty parameters
+//   are removed from the query, and an empty query is dropped;
+// - the fragment is dropped.
+//
+// Every step only ever shortens the URL. Returns the new length, or
+// nothing if the URL is malformed, in which case the buffer is left
+// partially rewritten.
+[[nodiscard]] std::optional<std::size_t>
+canonicalize(gsl::span<char> url) noexcept;
+
+} // namespace linkollector::url
@@ -1,12 +1,15 @@
 #include "context.h"
 
+#include "socket.h"
+
 #include <zmq.h>
 
 namespace wrappers::zmq {
 
 context::context() noexcept : m_context(zmq_ctx_new()) {}
 
-context::context(context &&other) noexcept : m_context(other.m_context) {
+context::context(context &&other) noexcept
+    : m_context(other.m_context), m_socket_options(other.m_socket_options) {
     other.m_context = nullptr;
 }
 
@@ -17,6 +20,7 @@ context &context::operator=(context &&other) noexcept {
         }
 
         this->m_context = other.m_context;
+        this->m_socket_options = other.m_socket_options;
         other.m_context = nullptr;
     }
 
@@ -30,4 +34,33 @@ context::~context() noexcept {
     }
 }
 
+bool context::set_io_threads(int count) noexcept {
+    return zmq_ctx_set(this->m_context, ZMQ_IO_THREADS, count) == 0;
+}
+
+bool context::set_io_thread_affinity(const std::vector<int> &cpus) noexcept {
+    for (const auto cpu : cpus) {
+        if (zmq_ctx_set(this->m_context, ZMQ_THREAD_AFFINITY_CPU_ADD, cpu) !=
+            0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool context::set_socket_options(const socket_options &options) noexcept {
+    this->m_socket_options = options;
+
+    // Try the options on a throwaway socket so they are rejected up front
+    // rather than on first use
+    socket probe(*this, socket::type::dealer);
+    return probe.apply(options);
+}
+
+void context::shutdown() noexcept {
+    if (this->m_context != nullptr) {
+        zmq_ctx_shutdown(this->m_context);
+    }
+}
+
 } // namespace wrappers::zmq
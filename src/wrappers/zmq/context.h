@@ -1,5 +1,9 @@
 #pragma once
 
+#include "socket_options.h"
+
+#include <vector>
+
 namespace wrappers::zmq {
 
 class context final {
@@ -12,10 +16,28 @@ public:
     context &operator=(context &&other) noexcept;
     ~context() noexcept;
 
+    // Only effective before the first socket is created.
+    [[nodiscard]] bool set_io_threads(int count) noexcept;
+
+    // Pins the IO threads to these CPUs. Only effective before the first
+    // socket is created.
+    [[nodiscard]] bool
+    set_io_thread_affinity(const std::vector<int> &cpus) noexcept;
+
+    // Applied to sockets created afterwards. Fails if libzmq rejects any of
+    // the options, in which case sockets created afterwards are unusable.
+    [[nodiscard]] bool
+    set_socket_options(const socket_options &options) noexcept;
+
+    // Makes all blocking operations on sockets of this context fail with
+    // ETERM, so threads owning them can wind down before destruction.
+    void shutdown() noexcept;
+
     friend class socket;
 
 private:
     void *m_context = nullptr;
+    socket_options m_socket_options;
 };
 
 } // namespace wrappers::zmq
@@ -0,0 +1,105 @@
+#include "message.h"
+
+#include <zmq.h>
+
+#include <utility>
+
+namespace wrappers::zmq {
+
+static_assert(sizeof(zmq_msg_t) <= sizeof(std::array<unsigned char, 64>));
+static_assert(alignof(zmq_msg_t) <= alignof(void *));
+
+template <typename Buffer>
+static void free_buffer([[maybe_unused]] void *data, void *hint) noexcept {
+    delete static_cast<Buffer *>(hint);
+}
+
+template <typename Buffer>
+static void init_from_buffer(zmq_msg_t *msg, Buffer &&buffer) noexcept {
+    if (buffer.empty()) {
+        zmq_msg_init(msg);
+        return;
+    }
+
+    // libzmq takes over the heap buffer; only the small owner is allocated
+    auto *owner = new Buffer(std::move(buffer));
+    if (zmq_msg_init_data(msg,
+                          static_cast<void *>(owner->data()),
+                          owner->size(),
+                          free_buffer<Buffer>,
+                          static_cast<void *>(owner)) == -1) {
+        delete owner;
+        zmq_msg_init(msg);
+    }
+}
+
+message::message() noexcept {
+    zmq_msg_init(static_cast<zmq_msg_t *>(this->handle()));
+}
+
+message::message(std::size_t size) noexcept {
+    auto *msg = static_cast<zmq_msg_t *>(this->handle());
+    if (zmq_msg_init_size(msg, size) == -1) {
+        zmq_msg_init(msg);
+    }
+}
+
+message::message(std::vector<std::byte> &&buffer) noexcept {
+    init_from_buffer(static_cast<zmq_msg_t *>(this->handle()),
+                     std::move(buffer));
+}
+
+message::message(std::string &&buffer) noexcept {
+    init_from_buffer(static_cast<zmq_msg_t *>(this->handle()),
+                     std::move(buffer));
+}
+
+message::message(message &&other) noexcept {
+    auto *msg = static_cast<zmq_msg_t *>(this->handle());
+    zmq_msg_init(msg);
+    zmq_msg_move(msg, static_cast<zmq_msg_t *>(other.handle()));
+}
+
+message &message::operator=(message &&other) noexcept {
+    if (this != &other) {
+        zmq_msg_move(static_cast<zmq_msg_t *>(this->handle()),
+                     static_cast<zmq_msg_t *>(other.handle()));
+    }
+
+    return *this;
+}
+
+message::~message() noexcept {
+    zmq_msg_close(static_cast<zmq_msg_t *>(this->handle()));
+}
+
+gsl::span<std::byte> message::data() noexcept {
+    auto *msg = static_cast<zmq_msg_t *>(this->handle());
+    return {static_cast<std::byte *>(zmq_msg_data(msg)), zmq_msg_size(msg)};
+}
+
+gsl::span<const std::byte> message::data() const noexcept {
+    // zmq_msg_data() does not take a const message, but does not modify it
+    auto *msg = const_cast<zmq_msg_t *>(
+        static_cast<const zmq_msg_t *>(this->handle()));
+    return {static_cast<const std::byte *>(zmq_msg_data(msg)),
+            zmq_msg_size(msg)};
+}
+
+std::size_t message::size() const noexcept {
+    return zmq_msg_size(static_cast<const zmq_msg_t *>(this->handle()));
+}
+
+bool message::more() const noexcept {
+    return zmq_msg_more(static_cast<const zmq_msg_t *>(this->handle())) != 0;
+}
+
+void *message::handle() noexcept {
+    return static_cast<void *>(this->m_msg.data());
+}
+
+const void *message::handle() const noexcept {
+    return static_cast<const void *>(this->m_msg.data());
+}
+
+} // namespace wrappers::zmq
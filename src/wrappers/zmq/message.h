@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <gsl/span>
+
+namespace wrappers::zmq {
+
+// If libzmq cannot allocate the frame, a message is left empty; callers
+// expecting content check size().
+class message final {
+
+public:
+    explicit message() noexcept;
+    explicit message(std::size_t size) noexcept;
+    explicit message(std::vector<std::byte> &&buffer) noexcept;
+    explicit message(std::string &&buffer) noexcept;
+    message(const message &other) = delete;
+    message &operator=(const message &other) = delete;
+    message(message &&other) noexcept;
+    message &operator=(message &&other) noexcept;
+    ~message() noexcept;
+
+    [[nodiscard]] gsl::span<std::byte> data() noexcept;
+    [[nodiscard]] gsl::span<const std::byte> data() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] bool more() const noexcept;
+
+    friend class socket;
+
+private:
+    [[nodiscard]] void *handle() noexcept;
+    [[nodiscard]] const void *handle() const noexcept;
+
+    // Storage for a zmq_msg_t, kept opaque so zmq.h stays out of headers
+    alignas(void *) std::array<unsigned char, 64> m_msg = {};
+};
+
+} // namespace wrappers::zmq
@@ -1 +1,21 @@
 #include "poll_event.h"
+
+#include "../../macros.h"
+
+#include <zmq.h>
+
+namespace wrappers::zmq {
+
+short to_zmq_event_type(poll_event event) noexcept {
+    switch (event) {
+    case poll_event::in: {
+        return ZMQ_POLLIN;
+    }
+    case poll_event::out: {
+        return ZMQ_POLLOUT;
+    }
+    }
+    LINKOLLECTOR_UNREACHABLE;
+}
+
+} // namespace wrappers::zmq
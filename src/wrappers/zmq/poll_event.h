@@ -7,4 +7,7 @@ enum class poll_event {
     out,
 };
 
+// Converts to the ZMQ_POLLIN/ZMQ_POLLOUT flags used by libzmq.
+[[nodiscard]] short to_zmq_event_type(poll_event event) noexcept;
+
 } // namespace wrappers::zmq
@@ -3,16 +3,20 @@
 namespace wrappers::zmq {
 
 poll_response::poll_response(socket &sock, poll_event event) noexcept
-    : response_socket(&sock), response_event(event) {}
+    : response_socket(&sock), response_event(event), response_fd() {}
+
+poll_response::poll_response(native_fd fd, poll_event event) noexcept
+    : response_socket(nullptr), response_event(event), response_fd(fd) {}
 
 poll_response::poll_response(const poll_response &other) noexcept
     : response_socket(other.response_socket),
-      response_event(other.response_event) {}
+      response_event(other.response_event), response_fd(other.response_fd) {}
 
 poll_response &poll_response::operator=(const poll_response &other) noexcept {
     if (this != &other) {
         this->response_socket = other.response_socket;
         this->response_event = other.response_event;
+        this->response_fd = other.response_fd;
     }
 
     return *this;
@@ -20,9 +24,10 @@ poll_response &poll_response::operator=(const poll_response &other) noexcept {
 
 poll_response::poll_response(poll_response &&other) noexcept
     : response_socket(other.response_socket),
-      response_event(other.response_event) {
+      response_event(other.response_event), response_fd(other.response_fd) {
     other.response_socket = nullptr;
     other.response_event = {};
+    other.response_fd = {};
 }
 
 poll_response &poll_response::operator=(poll_response &&other) noexcept {
@@ -31,6 +36,8 @@ poll_response &poll_response::operator=(poll_response &&other) noexcept {
         other.response_socket = nullptr;
         this->response_event = other.response_event;
         other.response_event = {};
+        this->response_fd = other.response_fd;
+        other.response_fd = {};
     }
 
     return *this;
@@ -2,20 +2,33 @@
 
 #include "poll_event.h"
 
+#include <cstdint>
+
 namespace wrappers::zmq {
 
 class socket;
 
+// What libzmq polls besides its sockets: a file descriptor, or a SOCKET on
+// Windows
+#ifdef _WIN32
+using native_fd = std::uintptr_t;
+#else
+using native_fd = int;
+#endif
+
 struct poll_response final {
     explicit poll_response(socket &sock, poll_event event) noexcept;
+    explicit poll_response(native_fd fd, poll_event event) noexcept;
     poll_response(const poll_response &other) noexcept;
     poll_response &operator=(const poll_response &other) noexcept;
     poll_response(poll_response &&other) noexcept;
     poll_response &operator=(poll_response &&other) noexcept;
     ~poll_response() = default;
 
+    // Null for a file descriptor, which is then in response_fd
     socket *response_socket;
     poll_event response_event;
+    native_fd response_fd;
 };
 
 } // namespace wrappers::zmq
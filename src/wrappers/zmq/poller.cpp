@@ -0,0 +1,166 @@
+#include "poller.h"
+
+#include "socket.h"
+
+#include <zmq.h>
+
+#include <cerrno>
+#include <iterator>
+#include <ratio>
+#include <type_traits>
+#include <utility>
+
+namespace wrappers::zmq {
+
+static_assert(std::is_same_v<native_fd, zmq_fd_t>,
+              "native_fd must match the descriptors libzmq polls");
+
+[[nodiscard]] static zmq_poller_event_t *
+as_zmq_events(std::vector<std::byte> &events) noexcept {
+    return static_cast<zmq_poller_event_t *>(
+        static_cast<void *>(events.data()));
+}
+
+poller::poller() noexcept : m_poller(zmq_poller_new()) {}
+
+poller::poller(poller &&other) noexcept
+    : m_poller(other.m_poller), m_size(other.m_size),
+      m_events(std::move(other.m_events)),
+      m_responses(std::move(other.m_responses)) {
+    other.m_poller = nullptr;
+    other.m_size = 0;
+}
+
+poller &poller::operator=(poller &&other) noexcept {
+    if (this != &other) {
+        if (this->m_poller != nullptr) {
+            zmq_poller_destroy(&this->m_poller);
+        }
+
+        this->m_poller = other.m_poller;
+        this->m_size = other.m_size;
+        this->m_events = std::move(other.m_events);
+        this->m_responses = std::move(other.m_responses);
+        other.m_poller = nullptr;
+        other.m_size = 0;
+    }
+
+    return *this;
+}
+
+poller::~poller() noexcept {
+    if (this->m_poller != nullptr) {
+        zmq_poller_destroy(&this->m_poller);
+        this->m_poller = nullptr;
+    }
+}
+
+bool poller::add(socket &sock, poll_event event) noexcept {
+    if (this->m_poller == nullptr ||
+        zmq_poller_add(this->m_poller,
+                       sock.m_socket,
+                       static_cast<void *>(&sock),
+                       to_zmq_event_type(event)) == -1) {
+        return false;
+    }
+
+    this->grow();
+    return true;
+}
+
+bool poller::remove(socket &sock) noexcept {
+    if (zmq_poller_remove(this->m_poller, sock.m_socket) == -1) {
+        return false;
+    }
+
+    --this->m_size;
+    return true;
+}
+
+bool poller::add_fd(native_fd fd, poll_event event) noexcept {
+    if (this->m_poller == nullptr ||
+        zmq_poller_add_fd(
+            this->m_poller, fd, nullptr, to_zmq_event_type(event)) == -1) {
+        return false;
+    }
+
+    this->grow();
+    return true;
+}
+
+bool poller::remove_fd(native_fd fd) noexcept {
+    if (zmq_poller_remove_fd(this->m_poller, fd) == -1) {
+        return false;
+    }
+
+    --this->m_size;
+    return true;
+}
+
+void poller::grow() noexcept {
+    ++this->m_size;
+    this->m_events.resize(this->m_size * sizeof(zmq_poller_event_t));
+    this->m_responses.reserve(this->m_size);
+}
+
+std::optional<gsl::span<const poll_response>>
+poller::wait(std::chrono::milliseconds timeout) noexcept {
+    this->m_responses.clear();
+
+    if (this->m_poller == nullptr) {
+        return std::nullopt;
+    }
+
+    // zmq_poller_wait_all() takes the timeout as a long
+    const auto zmq_timeout =
+        std::chrono::duration_cast<std::chrono::duration<long, std::milli>>(
+            timeout);
+
+    const auto zmq_rc = zmq_poller_wait_all(this->m_poller,
+                                            as_zmq_events(this->m_events),
+                                            static_cast<int>(this->m_size),
+                                            zmq_timeout.count());
+
+    if (zmq_rc == -1) {
+        const auto errnum = errno;
+        // EAGAIN signals an expired timeout
+        if (errnum == EAGAIN || errnum == EINTR) {
+            return {gsl::span<const poll_response>()};
+        }
+        return std::nullopt;
+    }
+
+    using unsigned_events_t =
+        std::make_unsigned_t<decltype(zmq_poller_event_t::events)>;
+
+    const auto *events = as_zmq_events(this->m_events);
+
+    for (int i = 0; i < zmq_rc; ++i) {
+        const auto &event = *std::next(events, i);
+        const auto received_events =
+            static_cast<unsigned_events_t>(event.events);
+
+        poll_event event_type{};
+        if ((received_events & static_cast<unsigned_events_t>(ZMQ_POLLIN)) >
+            0) {
+            event_type = poll_event::in;
+        } else if ((received_events &
+                    static_cast<unsigned_events_t>(ZMQ_POLLOUT)) > 0) {
+            event_type = poll_event::out;
+        } else {
+            continue;
+        }
+
+        // Sockets are registered with themselves as user data
+        if (event.user_data != nullptr) {
+            this->m_responses.emplace_back(
+                *static_cast<socket *>(event.user_data), event_type);
+        } else {
+            this->m_responses.emplace_back(event.fd, event_type);
+        }
+    }
+
+    return {gsl::span<const poll_response>(this->m_responses)};
+}
+
+} // namespace wrappers::zmq
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "poll_event.h"
+#include "poll_response.h"
+
+#include <gsl/span>
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace wrappers::zmq {
+
+class socket;
+
+// Long-lived set of sockets to wait on. Sockets are registered once and
+// waiting reuses buffers sized at registration, so an event loop built on
+// a poller does not allocate per iteration.
+class poller final {
+
+public:
+    static constexpr std::chrono::milliseconds infinite{-1};
+
+    // If libzmq cannot create the poller, adding to it and waiting on it
+    // fail.
+    explicit poller() noexcept;
+    poller(const poller &other) = delete;
+    poller &operator=(const poller &other) = delete;
+    poller(poller &&other) noexcept;
+    poller &operator=(poller &&other) noexcept;
+    ~poller() noexcept;
+
+    [[nodiscard]] bool add(socket &sock, poll_event event) noexcept;
+    [[nodiscard]] bool remove(socket &sock) noexcept;
+
+    // Waits on a file descriptor alongside the sockets. Its responses have
+    // no socket, only the descriptor.
+    [[nodiscard]] bool add_fd(native_fd fd, poll_event event) noexcept;
+    [[nodiscard]] bool remove_fd(native_fd fd) noexcept;
+
+    // Waits up to timeout for events on the registered sockets. The
+    // returned responses stay valid until the next call; they are empty
+    // if the timeout expired or a signal interrupted the wait.
+    [[nodiscard]] std::optional<gsl::span<const poll_response>>
+    wait(std::chrono::milliseconds timeout = infinite) noexcept;
+
+private:
+    // Makes room for the events of one more registration
+    void grow() noexcept;
+
+    void *m_poller = nullptr;
+    std::size_t m_size = 0;
+    std::vector<std::byte> m_events;
+    std::vector<poll_response> m_responses;
+};
+
+} // namespace wrappers::zmq
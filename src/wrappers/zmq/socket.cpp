@@ -5,6 +5,8 @@
 
 #include <zmq.h>
 
+#include <array>
+#include <climits>
 #include <cstring>
 
 namespace wrappers::zmq {
@@ -52,11 +54,24 @@ to_zmq_socket_type(socket::type socket_type) {
     LINKOLLECTOR_UNREACHABLE;
 }
 
+template <typename Value>
+[[nodiscard]] static bool
+set_option(void *socket_, int option, Value value) noexcept {
+    return zmq_setsockopt(socket_, option, &value, sizeof(Value)) == 0;
+}
+
 socket::socket(context &ctx, type socket_type) noexcept
     : m_socket(zmq_socket(ctx.m_context, to_zmq_socket_type(socket_type))) {
     constexpr const int no_linger = 0;
     zmq_setsockopt(
         this->m_socket, ZMQ_LINGER, &no_linger, sizeof(decltype(no_linger)));
+
+    // A socket that rejects its tuning fails every later call instead of
+    // silently running untuned
+    if (this->m_socket != nullptr && !this->apply(ctx.m_socket_options)) {
+        zmq_close(this->m_socket);
+        this->m_socket = nullptr;
+    }
 }
 
 socket::socket(socket &&other) noexcept {
@@ -84,6 +99,78 @@ socket::~socket() noexcept {
     }
 }
 
+bool socket::set_send_high_water_mark(int messages) noexcept {
+    return set_option(this->m_socket, ZMQ_SNDHWM, messages);
+}
+
+bool socket::set_receive_high_water_mark(int messages) noexcept {
+    return set_option(this->m_socket, ZMQ_RCVHWM, messages);
+}
+
+bool socket::set_send_buffer_size(int bytes) noexcept {
+    return set_option(this->m_socket, ZMQ_SNDBUF, bytes);
+}
+
+bool socket::set_receive_buffer_size(int bytes) noexcept {
+    return set_option(this->m_socket, ZMQ_RCVBUF, bytes);
+}
+
+bool socket::set_tcp_keepalive(const tcp_keepalive &keepalive) noexcept {
+    // libzmq takes the times as ints, larger ones would wrap
+    if (keepalive.idle.count() > INT_MAX ||
+        keepalive.interval.count() > INT_MAX) {
+        return false;
+    }
+
+    return set_option(this->m_socket, ZMQ_TCP_KEEPALIVE, 1) &&
+           set_option(this->m_socket,
+                      ZMQ_TCP_KEEPALIVE_IDLE,
+                      static_cast<int>(keepalive.idle.count())) &&
+           set_option(this->m_socket,
+                      ZMQ_TCP_KEEPALIVE_INTVL,
+                      static_cast<int>(keepalive.interval.count())) &&
+           set_option(this->m_socket, ZMQ_TCP_KEEPALIVE_CNT, keepalive.count);
+}
+
+bool socket::set_max_message_size(std::int64_t bytes) noexcept {
+    return set_option(this->m_socket, ZMQ_MAXMSGSIZE, bytes);
+}
+
+bool socket::set_immediate(bool immediate) noexcept {
+    return set_option(this->m_socket, ZMQ_IMMEDIATE, immediate ? 1 : 0);
+}
+
+bool socket::apply(const socket_options &options) noexcept {
+    bool ok = true;
+
+    if (options.send_high_water_mark.has_value()) {
+        ok = this->set_send_high_water_mark(*options.send_high_water_mark) &&
+             ok;
+    }
+    if (options.receive_high_water_mark.has_value()) {
+        ok = this->set_receive_high_water_mark(
+                 *options.receive_high_water_mark) &&
+             ok;
+    }
+    if (options.send_buffer_size.has_value()) {
+        ok = this->set_send_buffer_size(*options.send_buffer_size) && ok;
+    }
+    if (options.receive_buffer_size.has_value()) {
+        ok = this->set_receive_buffer_size(*options.receive_buffer_size) && ok;
+    }
+    if (options.keepalive.has_value()) {
+        ok = this->set_tcp_keepalive(*options.keepalive) && ok;
+    }
+    if (options.max_message_size.has_value()) {
+        ok = this->set_max_message_size(*options.max_message_size) && ok;
+    }
+    if (options.immediate.has_value()) {
+        ok = this->set_immediate(*options.immediate) && ok;
+    }
+
+    return ok;
+}
+
 bool socket::bind(const std::string &endpoint) noexcept {
     return zmq_bind(this->m_socket, endpoint.c_str()) == 0;
 }
@@ -92,8 +179,24 @@ bool socket::connect(const std::string &endpoint) noexcept {
     return zmq_connect(this->m_socket, endpoint.c_str()) == 0;
 }
 
+std::optional<std::string> socket::last_endpoint() const noexcept {
+    // Large enough for any endpoint libzmq reports
+    std::array<char, 1024> endpoint = {};
+    auto endpoint_size = endpoint.size();
+    if (zmq_getsockopt(this->m_socket,
+                       ZMQ_LAST_ENDPOINT,
+                       endpoint.data(),
+                       &endpoint_size) != 0 ||
+        endpoint_size == 0) {
+        return std::nullopt;
+    }
+
+    // The reported size includes the terminating null
+    return {std::string(endpoint.data(), endpoint_size - 1)};
+}
+
 bool socket::blocking_send() noexcept {
-    return blocking_send({});
+    return blocking_send(gsl::span<std::byte>{});
 }
 
 bool socket::blocking_send(gsl::span<std::byte> message) noexcept {
@@ -102,7 +205,9 @@ bool socket::blocking_send(gsl::span<std::byte> message) noexcept {
     }
 
     zmq_msg_t msg;
-    zmq_msg_init_size(&msg, message.size());
+    if (zmq_msg_init_size(&msg, message.size()) == -1) {
+        return false;
+    }
     std::memcpy(zmq_msg_data(&msg),
                 static_cast<void *>(message.data()),
                 message.size());
@@ -115,6 +220,18 @@ bool socket::blocking_send(gsl::span<std::byte> message) noexcept {
     return true;
 }
 
+bool socket::blocking_send(message &&msg) noexcept {
+    return zmq_msg_send(static_cast<zmq_msg_t *>(msg.handle()),
+                        this->m_socket,
+                        /* flags: */ 0) != -1;
+}
+
+bool socket::blocking_send_more(message &&msg) noexcept {
+    return zmq_msg_send(static_cast<zmq_msg_t *>(msg.handle()),
+                        this->m_socket,
+                        ZMQ_SNDMORE) != -1;
+}
+
 std::optional<std::vector<std::byte>> socket::blocking_receive() noexcept {
     zmq_msg_t msg;
     zmq_msg_init(&msg);
@@ -130,9 +247,37 @@ std::optional<std::vector<std::byte>> socket::blocking_receive() noexcept {
     std::advance(data_end, static_cast<std::ptrdiff_t>(zmq_msg_size(&msg)));
 
     std::vector<std::byte> buf(data, data_end);
+    zmq_msg_close(&msg);
     return {std::move(buf)};
 }
 
+bool socket::blocking_receive(message &msg) noexcept {
+    return zmq_msg_recv(static_cast<zmq_msg_t *>(msg.handle()),
+                        this->m_socket,
+                        /* flags: */ 0) != -1;
+}
+
+std::optional<std::size_t>
+socket::blocking_receive(gsl::span<std::byte> buffer) noexcept {
+    const auto zmq_rc = zmq_recv(this->m_socket,
+                                 static_cast<void *>(buffer.data()),
+                                 buffer.size(),
+                                 /* flags: */ 0);
+    if (zmq_rc == -1) {
+        return std::nullopt;
+    }
+
+    return {static_cast<std::size_t>(zmq_rc)};
+}
+
+bool socket::more() const noexcept {
+    int more = 0;
+    auto more_size = sizeof(more);
+    return zmq_getsockopt(this->m_socket, ZMQ_RCVMORE, &more, &more_size) ==
+               0 &&
+           more != 0;
+}
+
 bool socket::async_receive(void *data,
                            void (*callback)(void *,
                                             gsl::span<std::byte>)) noexcept {
@@ -166,4 +311,30 @@ bool socket::async_receive(void *data,
     return true;
 }
 
+bool socket::forward(socket &destination) noexcept {
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+
+    bool more = true;
+
+    while (more) {
+        if (zmq_msg_recv(&msg, this->m_socket, /* flags: */ 0) == -1) {
+            zmq_msg_close(&msg);
+            return false;
+        }
+
+        more = zmq_msg_more(&msg) != 0;
+
+        if (zmq_msg_send(&msg,
+                         destination.m_socket,
+                         more ? ZMQ_SNDMORE : 0) == -1) {
+            zmq_msg_close(&msg);
+            return false;
+        }
+    }
+
+    zmq_msg_close(&msg);
+    return true;
+}
+
 } // namespace wrappers::zmq
@@ -1,10 +1,10 @@
 #pragma once
 
-#include "poll_event.h"
-#include "poll_response.h"
-#include "poll_target.h"
+#include "message.h"
+#include "socket_options.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <vector>
@@ -40,22 +40,54 @@ public:
     socket &operator=(socket &&other) noexcept;
     ~socket() noexcept;
 
+    // Options must be set before bind() or connect() to take effect.
+    [[nodiscard]] bool set_send_high_water_mark(int messages) noexcept;
+    [[nodiscard]] bool set_receive_high_water_mark(int messages) noexcept;
+    [[nodiscard]] bool set_send_buffer_size(int bytes) noexcept;
+    [[nodiscard]] bool set_receive_buffer_size(int bytes) noexcept;
+    [[nodiscard]] bool
+    set_tcp_keepalive(const tcp_keepalive &keepalive) noexcept;
+    [[nodiscard]] bool set_max_message_size(std::int64_t bytes) noexcept;
+    [[nodiscard]] bool set_immediate(bool immediate) noexcept;
+
+    // Sets every option given in options.
+    [[nodiscard]] bool apply(const socket_options &options) noexcept;
+
     [[nodiscard]] bool bind(const std::string &endpoint) noexcept;
 
     [[nodiscard]] bool connect(const std::string &endpoint) noexcept;
 
+    // The endpoint last bound, with any wildcard resolved, e.g. the port
+    // chosen for tcp://127.0.0.1:*.
+    [[nodiscard]] std::optional<std::string> last_endpoint() const noexcept;
+
     [[nodiscard]] bool blocking_send() noexcept;
     [[nodiscard]] bool blocking_send(gsl::span<std::byte> message) noexcept;
+    [[nodiscard]] bool blocking_send(message &&msg) noexcept;
+    [[nodiscard]] bool blocking_send_more(message &&msg) noexcept;
 
     [[nodiscard]] std::optional<std::vector<std::byte>>
     blocking_receive() noexcept;
+    [[nodiscard]] bool blocking_receive(message &msg) noexcept;
+
+    // Copies the next frame into buffer and returns its full size, which
+    // exceeds the buffer's if the frame was truncated.
+    [[nodiscard]] std::optional<std::size_t>
+    blocking_receive(gsl::span<std::byte> buffer) noexcept;
+
+    // Whether more frames of the same message follow the last one
+    // received.
+    [[nodiscard]] bool more() const noexcept;
 
     [[nodiscard]] bool
     async_receive(void *data,
                   void (*callback)(void *, gsl::span<std::byte>)) noexcept;
 
-    friend std::optional<std::vector<poll_response>>
-    blocking_poll(gsl::span<poll_target> targets) noexcept;
+    // Moves one complete (possibly multipart) message to destination
+    // without copying its frames.
+    [[nodiscard]] bool forward(socket &destination) noexcept;
+
+    friend class poller;
 
 private:
     void *m_socket = nullptr;
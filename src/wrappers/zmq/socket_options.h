@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace wrappers::zmq {
+
+struct tcp_keepalive final {
+    std::chrono::seconds idle;
+    std::chrono::seconds interval;
+    int count;
+};
+
+// Options applied to every socket a context creates. Unset options keep
+// the libzmq defaults.
+struct socket_options final {
+    std::optional<int> send_high_water_mark;
+    std::optional<int> receive_high_water_mark;
+    std::optional<int> send_buffer_size;
+    std::optional<int> receive_buffer_size;
+    std::optional<tcp_keepalive> keepalive;
+    std::optional<std::int64_t> max_message_size;
+    std::optional<bool> immediate;
+};
+
+} // namespace wrappers::zmq